@@ -0,0 +1,85 @@
+// FIELDINDEX.CPP
+// secondary indexes on the numeric goal fields
+// Copyright 2018 Thanasis Karpetis
+//
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+#include "fieldindex.h"
+
+void BucketIndex::add( int value, int idx ) {
+	auto &b=buckets[value];
+	if (b.empty() || b.back()<idx)
+		b.push_back(idx);	// a new record
+	else
+		b.insert(std::lower_bound(b.begin(),b.end(),idx),idx);
+}
+
+void BucketIndex::remove( int value, int idx ) {
+	auto &b=buckets[value];
+	auto it=std::lower_bound(b.begin(),b.end(),idx);
+	if (it!=b.end() && *it==idx)
+		b.erase(it);
+}
+
+// a dropped record maps to -1, the others keep their relative order
+void BucketIndex::remap( const std::vector<int> &newIndex ) {
+	for (auto &b:buckets) {
+		for (auto &idx:b)
+			idx=newIndex[idx];
+		b.erase(std::remove(b.begin(),b.end(),-1),b.end());
+	}
+}
+
+size_t BucketIndex::count( int lo, int hi ) const {
+	size_t n=0;
+	for (int value=std::max(lo,0); value<=hi && value<values; value++)
+		n+=buckets[value].size();
+	return n;
+}
+
+void BucketIndex::clear() {
+	for (auto &b:buckets)
+		b.clear();
+}
+
+void BucketIndex::reserve( size_t records ) {
+	for (auto &b:buckets)
+		b.reserve(records/values+1);
+}
+
+void CostIndex::build() {
+	std::sort(order.begin(),order.end(),[this]( int a, int b ) { return less(a,b); });
+	built=true;
+}
+
+std::pair<const int*,const int*> CostIndex::range( double lo, double hi ) const {
+	auto first=std::lower_bound(order.begin(),order.end(),lo,
+			[this]( int idx, double c ) { return costs[idx]<c; });
+	auto last=std::upper_bound(first,order.end(),hi,
+			[this]( double c, int idx ) { return c<costs[idx]; });
+	return {order.data()+(first-order.begin()),order.data()+(last-order.begin())};
+}
+
+void CostIndex::add( int idx ) {
+	if (built)
+		order.insert(std::lower_bound(order.begin(),order.end(),idx,
+				[this]( int a, int b ) { return less(a,b); }),idx);
+}
+
+void CostIndex::remove( int idx ) {
+	if (!built)
+		return;
+	auto it=std::lower_bound(order.begin(),order.end(),idx,[this]( int a, int b ) { return less(a,b); });
+	if (it!=order.end() && *it==idx)
+		order.erase(it);
+}
+
+void CostIndex::remap( const std::vector<int> &newIndex ) {
+	if (!built)
+		return;
+	for (auto &idx:order)
+		idx=newIndex[idx];
+	order.erase(std::remove(order.begin(),order.end(),-1),order.end());
+}
@@ -6,127 +6,550 @@
 // file LICENSE or http://www.opensource.org/licenses/mit-license.php.
 
 #include <set>
+#include <sstream>
+#include <cctype>
 #include <algorithm>
+#include <charconv>
+#include <iterator>
 #include "goals.h"
+#include "threadpool.h"
+#include "journal.h"
+#include "saveworker.h"
+#include "radixsort.h"
+#include "parallelsort.h"
 
 std::ostream& operator <<( std::ostream& out, const Goal &goal) {
 	return goal.print(out);
 }
 
-// dumps the goal vector's entries to a stream
+void GoalColumns::clear() {
+	arena.clear();
+	names.clear();
+	priorities.clear();
+	completions.clear();
+	unitcosts.clear();
+}
+
+void GoalColumns::reserve( size_t n ) {
+	names.reserve(n);
+	priorities.reserve(n);
+	completions.reserve(n);
+	unitcosts.reserve(n);
+}
+
+void GoalColumns::push_back( const Goal &goal ) {
+	names.push_back(arena.add(goal.name));
+	priorities.push_back(goal.priority);
+	completions.push_back(goal.completion);
+	unitcosts.push_back(goal.unitcost);
+}
+
+void GoalColumns::push_back( const GoalColumns &from, int idx ) {
+	names.push_back(arena.add(from.names[idx]));
+	priorities.push_back(from.priorities[idx]);
+	completions.push_back(from.completions[idx]);
+	unitcosts.push_back(from.unitcosts[idx]);
+}
+
+void GoalColumns::set( int idx, const Goal &goal ) {
+	if (goal.name!=names[idx]) {
+		arena.drop(names[idx]);
+		names[idx]=arena.add(goal.name);
+	}
+	priorities[idx]=goal.priority;
+	completions[idx]=goal.completion;
+	unitcosts[idx]=goal.unitcost;
+}
+
+namespace {
+
+const size_t pageBlock=1<<20;	// listings without paging are written out in blocks of this size
 
-int GoalContainer::printAll(std::ostream& strm,int first, int maxToPrint) const {
+// right-aligned in width columns like std::setw() pads, longer text is not cut
+void appendField( std::string &out, std::string_view text, size_t width ) {
+	if (text.size()<width)
+		out.append(width-text.size(),' ');
+	out+=text;
+}
+
+void appendField( std::string &out, int value, size_t width ) {
+	char digits[16];
+	auto res=std::to_chars(digits,digits+sizeof(digits),value);
+	appendField(out,std::string_view{digits,size_t(res.ptr-digits)},width);
+}
+
+// one row as Goal::print() writes it, unitcost as the stream's default %g of 6 digits
+void appendRow( std::string &out, const GoalColumns &v, int idx ) {
+	appendField(out,v.name(idx),40);
+	appendField(out,v.priority(idx),9);
+	appendField(out,v.completion(idx),12);
+	out.append(7,' ');
+	char digits[32];
+	auto res=std::to_chars(digits,digits+sizeof(digits),v.unitcost(idx),std::chars_format::general,6);
+	out.append(digits,res.ptr-digits);
+	out+='\n';
+}
+
+} // namespace
+
+// dumps the goal vector's entries to a stream. A page is formatted into one buffer and written
+// at once, an unpaged listing a block at a time
+
+int GoalContainer::printAll(std::ostream& strm,int first, int maxToPrint) {
 	if (sorted.empty()) 
 		return 0;
-	int idx;
-	for ( idx = first; idx < sorted.size() && idx < first + maxToPrint; idx++ ) {
-		if (UserOptions::getInstance().getShowNum() ) 
-			std::cout<<std::setfill(' ')<<std::setw(4)<<idx+1<<".";
-		v[sorted[idx]].print(strm);
+	ensureSorted(size_t(first)+maxToPrint);	// just this page, when paging
+	size_t end=std::min(sorted.size(),size_t(first)+maxToPrint);
+	bool showNum=UserOptions::getInstance().getShowNum();
+	std::string page;
+	page.reserve(std::min(pageBlock,(end>size_t(first)? end-first : 0)*96)+256);
+	for (size_t idx=first;idx<end;idx++) {
+		if (showNum) {
+			appendField(page,int(idx+1),4);
+			page+='.';
+		}
+		appendRow(page,v,sorted[idx]);
+		if (page.size()>=pageBlock) {
+			strm.write(page.data(),page.size());
+			page.clear();
+		}
 	}
-	return idx%sorted.size(); 
+	strm.write(page.data(),page.size());
+	return std::max(size_t(first),end)%sorted.size(); 
 }
 
 // insert a new goal in the goal vector, also adding to helper structures
-// side effect: sets modifiedGoals and refreshSort to true
+// side effect: sets modifiedGoals to true. a visible new record is placed into sorted when that is
+// up to date, otherwise refreshSort is raised
 //
 void GoalContainer::insertGoal( const Goal& goal ) {
 	if (goal.name.empty()) return;    // name is mandatory
-	auto res=names.insert(std::make_pair(goal.name,(int)v.size())); //add to names set, if not already in
-
-	if ( res.first!=names.end() && res.second ) { // succeeded, not a duplicate
-		int idx=v.size();
-		v.push_back(goal);	//unique records, keep initial order
-		active.insert( active.end(),idx); //hint insert at the end
-		if (matchGoal(idx))
-			searchRes.insert(searchRes.end(),idx);//only records matching the search are visible
+	if (!GoalColumns::inRange(goal)) {	// the editor and loader never produce these, an old journal may
+		insertGoal(GoalColumns::clamped(goal));
+		return;
+	}
+	int idx=v.size();
+	bool current=viewIsCurrent();
+	if ( names.insert(goal.name,idx) ) { // succeeded, not a duplicate
+		v.push_back(goal);	//unique records, keep initial order. the index reads the name from here
+		byPriority.add(goal.priority,idx);
+		byCompletion.add(goal.completion,idx);
+		byCost.add(idx);
+		byTrigram.add(idx);
+		active.push_back(true);	// both sets grow with v
+		bool visible=matchGoal(idx);	//only records matching the search are visible
+		searchRes.push_back(visible);
+		if (!current)
+			refreshSort=true; // signify re-sorting is in order
+		else if (visible)
+			placeSorted(idx);
+		recordsChanged(current);
+		logEdit(JournalEntry{JournalEntry::OP_INSERT,goal.name,goal});
 	}
 	modifiedGoals=true;	
-	refreshSort=true; // signify re-sorting is in order
 }
 
+GoalContainer::GoalContainer():modifiedGoals{false},names{v.nameColumn()},byCost{v.costColumn()},byTrigram{v.nameColumn()},useTrigrams{true},sortedPrefix{0},sortver{-1},specver{-1},dataver{0},viewKey{"",SearchCriteria{},~uint64_t(0)},searchver{-1},matcherver{-1},refreshSort{true},refreshSearch{true},
+		mappedParsing{true},parallelLoading{true},parallelLoadMin{1<<20},
+		useSnapshots{true},useJournal{true},loading{false},lastSave{std::chrono::steady_clock::now()},
+		compactionRatio{0.25} {}
+
+GoalContainer::~GoalContainer() {}// out of line, where Journal and SaveWorker are complete types
+
 // loads unique named goal entries from specified file
 // side effect: vector of goals is wiped clean to contain only the new entries.
 
 int GoalContainer::loadFile( const std::string &name) {
+	waitForSave();		// the journal may still be rebased by a save of the previous file
 	v.clear();
 	active.clear();
 	names.clear();
+	byPriority.clear();
+	byCompletion.clear();
+	byCost.clear();
+	byTrigram.clear();
 	searchRes.clear();
+	sorted.clear();
+	sortedPrefix=0;
+	recordsChanged(false);
 
 	filename= name;//store the filename of the container's records for saving
+	if (journal)
+		journal->close();
+	loading=true;
 	try {
-
-		XMLParser parser{name};
-		std::string header = parser.getHeader();
-		std::string root = parser.getLabel(); // root element, <goalkeeper>
-		std::string label= parser.getLabel(); // read the first <goal> label
-		std::string endLabel = std::string{"/"} + root;
-		while (label != endLabel && parser.moreToGo()) {
-			if (label=="goal") {
-				Goal goal= readGoal(parser,label);//given the label, load the struct
-				insertGoal(goal);	
-				label = parser.getLabel();//read the next label
+		if (!useSnapshots || !loadSnapshot()) { // an up to date binary snapshot spares the parsing
+			if (mappedParsing) {
+				MappedFile file{name};
+				if (!loadSharded(file)) {
+					MappedXMLParser parser{file.begin(),file.end(),file.good()};
+					loadGoals(parser);
+				}
+			}
+			else {
+				XMLParser parser{name};
+				loadGoals(parser);
 			}
-			else throw(std::runtime_error("Entries of a different type detected"));
-		}	
+		}
 	} catch(std::exception &e){
 		std::cerr<<"exception caught: "<<e.what()<<'\n';
 	}
+	if (useJournal)
+		replayJournal();// edits made since the file was last written, possibly before a crash
+	loading=false;
+	compactIfNeeded();	// deletions replayed from the journal
 	sortGoals();
 	modifiedGoals=false;
+	lastSave=std::chrono::steady_clock::now();
 	return v.size();
 }
 
-// saves xml file containing goal records disregarding sort order.
-// sideEffect: creates a .bak file of the existing (supposedly original) file
-// before overwriting
+std::string GoalContainer::journalName() const {
+	return filename+".journal";
+}
 
-bool GoalContainer::saveFile() {
-	if ( isModified() ) {
-		std::cerr<<"creating backup file "<<filename<<".bak\n";
-		system( ("cp "+filename+" "+filename+".bak -f").c_str() );
-		std::cerr<<"saving to "<<filename<<"...\n";
-		//create backup
-		try{
-			XMLWriter writer{filename};
-			writer.writeHeader();
-			writer.openLabel("goalkeeper",true); //root element
-
-			for (auto idx:active) //skip the deleted records
-				writeGoal( writer,v[idx]);
-			writer.closeLabel();
-		} catch (std::exception& e) {
-			std::cerr<<"Exception caught while saving file:"<<e.what()<<"\n";
-			return false;
+// applies the journal of the file on top of the records just loaded, and keeps it open for new edits
+void GoalContainer::replayJournal() {
+	if (!journal)
+		journal.reset(new Journal);
+	for (auto &entry:journal->open(journalName(),FileSignature::of(filename))) {
+		int idx=findNameIndex(entry.name);
+		switch (entry.op) {
+			case JournalEntry::OP_INSERT: insertGoal(entry.goal); break;
+			case JournalEntry::OP_MODIFY: 
+				if (idx>=0 && (findNameIndex(entry.goal.name)<0 || findNameIndex(entry.goal.name)==idx))
+					modifyGoal(idx,GoalColumns::clamped(entry.goal));
+				break;
+			case JournalEntry::OP_DELETE: if (idx>=0) removeGoal(idx); break;
+		}
+	}
+}
+
+// records an edit in the journal before it is acknowledged to the user.
+// if the journal cannot be written, saving falls back to rewriting the whole file
+void GoalContainer::logEdit( const JournalEntry &entry ) {
+	if (loading || !journal || !journal->isOpen())
+		return;
+	try {
+		journal->append(entry);
+	} catch (std::exception &e) {
+		std::cerr<<e.what()<<", journal disabled\n";
+		journal->close();
+	}
+}
+
+// reads the root element and every goal record in it, with either parser backend
+
+template <class Parser>
+void GoalContainer::loadGoals( Parser &parser ) {
+	parser.getHeader();
+	std::string root{parser.getLabel()}; // root element, <goalkeeper>
+	auto label= parser.getLabel(); // read the first <goal> label
+	std::string endLabel = std::string{"/"} + root;
+	while (label != endLabel && parser.moreToGo()) {
+		if (label=="goal") {
+			Goal goal= decodeGoal(parser,label);//given the label, load the struct
+			insertGoal(goal);
+			label = parser.getLabel();//read the next label
 		}
+		else throw(std::runtime_error("Entries of a different type detected"));
+	}
+}
+
+// splits the goal records of a mapped file at </goal> boundaries and decodes the shards on the
+// thread pool, then inserts them in file order so the first occurrence of a name still wins.
+// Returns false, having inserted nothing, when the file is better loaded serially: small files,
+// a single thread, or any shard failing to parse. The serial parser then reports errors as usual.
+
+bool GoalContainer::loadSharded( const MappedFile &file ) {
+	ThreadPool &pool=ThreadPool::getInstance();
+	if (!parallelLoading || pool.size()<2 || file.size()<parallelLoadMin)
+		return false;
+	std::string endLabel{"/"};
+	const char *body;
+	try {
+		MappedXMLParser head{file.begin(),file.end()};
+		head.getHeader();
+		endLabel+=head.getLabel();	// root element, <goalkeeper>
+		body=head.position();
+	} catch (std::exception &e) {
+		return false;
+	}
+	// a few shards per thread keep the workers busy when record sizes vary
+	const std::string_view closing{"</goal>"};
+	std::string_view rest{body,size_t(file.end()-body)};
+	size_t step=rest.size()/(pool.size()*4)+1;
+	std::vector<const char*> bounds{body};
+	for (size_t pos=step; pos<rest.size(); pos+=step) {
+		size_t found=rest.find(closing,pos);
+		if (found==std::string_view::npos)
+			break;
+		pos=found+closing.size();
+		bounds.push_back(body+pos);
 	}
+	bounds.push_back(file.end());
+
+	size_t shards=bounds.size()-1;
+	std::vector<std::vector<Goal>> results(shards);
+	std::vector<char> failed(shards,0);
+	pool.run(shards,[&]( size_t s ) {
+		bool last= (s+1==shards);
+		bool ended=false;
+		try {
+			MappedXMLParser parser{bounds[s],bounds[s+1]};
+			while (parser.moreToGo()) {
+				auto label=parser.getLabel();
+				if (label=="goal")
+					results[s].push_back(decodeGoal(parser,label));
+				else if (last && label==endLabel) {
+					ended=true;
+					break;
+				}
+				else throw(std::runtime_error("Entries of a different type detected"));
+			}
+		} catch (std::exception &e) {
+			failed[s]=1;
+		}
+		if (last && !ended)
+			failed[s]=1;	// the root element must close in the last shard
+	});
+	for (auto f:failed)
+		if (f)
+			return false;
+	size_t total=0;
+	for (auto &shard:results)
+		total+=shard.size();
+	v.reserve(total);
+	names.reserve(total);
+	byPriority.reserve(total);
+	byCompletion.reserve(total);
+	for (auto &shard:results)
+		for (auto &goal:shard)
+			insertGoal(goal);
 	return true;
 }
 
+// saves the goal records. When the journal already holds every edit on disk, saving only marks
+// them as kept, costing nothing per record. Once the journal grows past a sixteenth of the records,
+// or when there is no usable journal, the whole file is rewritten instead, see writeFile()
+
+bool GoalContainer::saveFile() {
+	saveInBackground();
+	return waitForSave();
+}
+
+void GoalContainer::saveInBackground() {
+	if ( !isModified() )
+		return;
+	lastSave=std::chrono::steady_clock::now();
+	// modifications that did not go through the journal need the full rewrite
+	if (journal && journal->isOpen() && journal->name()==journalName() && journal->unsaved()>0 &&
+			journal->entries() <= activesize()/16) {
+		journal->markSaved();
+		modifiedGoals=false;
+		return;
+	}
+	writeFile();
+}
+
+bool GoalContainer::waitForSave() {
+	return collectSave(true);
+}
+
+// called from the main loop between commands, so an idle session never touches the disk
+void GoalContainer::autosave() {
+	collectSave(false);
+	int interval=UserOptions::getInstance().getAutosave();
+	if (interval<=0 || !isModified())
+		return;
+	if (std::chrono::steady_clock::now()-lastSave >= std::chrono::seconds(interval))
+		saveInBackground();
+}
+
+bool GoalContainer::collectSave( bool block ) {
+	if (!saver)
+		return true;
+	std::string errors= block? saver->wait() : saver->errors();
+	if (errors.empty())
+		return true;
+	std::cerr<<"Exception caught while saving file:"<<errors<<"\n";
+	modifiedGoals=true;	// still to be saved
+	return false;
+}
+
+bool GoalContainer::foldJournal() {
+	writeFile();
+	return waitForSave();
+}
+
+void GoalContainer::discardChanges() {
+	if (journal)
+		journal->discardSession();
+}
+
+// saves xml file containing goal records disregarding sort order.
+// The active records are copied and written by the save worker, so the caller goes on at once and
+// later edits cannot reach the file being written. Those edits are journaled past the copy's
+// journal position, which the rewritten journal keeps for the new file, see Journal::rebase().
+// sideEffect: keeps the existing (supposedly original) file as .bak and refreshes the
+// binary snapshot next to it
+
+void GoalContainer::writeFile() {
+	std::cerr<<"saving to "<<filename<<", previous version kept as "<<filename<<".bak\n";
+	auto records=std::make_shared<GoalColumns>();
+	records->reserve(activesize());
+	active.forEach([&]( int idx ) { //skip the deleted records
+		records->push_back(v,idx);
+	});
+	Journal *log=nullptr;
+	uint64_t folded=0;
+	if (journal && journal->isOpen()) {
+		if (journal->name()!=journalName())
+			journal->start(journalName());// saved under a new name, the old file keeps its journal
+		folded=journal->position();
+		journal->markSaved();
+		log=journal.get();
+	}
+	if (!saver)
+		saver.reset(new SaveWorker);
+	saver->submit([name=filename,records,snapshot=useSnapshots,log,folded] {
+		writeRecords(name,*records,snapshot,log,folded);
+	});
+	modifiedGoals=false;
+}
+
+// the new file replaces the old one atomically, so a crash leaves either of them intact.
+// the journal is rebased onto the new file just before the rename, see Journal::rebase()
+
+void GoalContainer::writeRecords( const std::string &name, const GoalColumns &records, bool snapshot,
+		Journal *log, uint64_t folded ) {
+	XMLWriter writer{name};
+	writer.reserve(records.size()*128);// a typical record is a little over 100 bytes
+	writer.writeHeader();
+	writer.openLabel("goalkeeper",true); //root element
+	for (size_t idx=0; idx<records.size(); idx++)
+		writeGoal(writer,records,idx);
+	writer.closeLabel();
+	writer.flush(true,[&]( int fd ) { // written aside and renamed over the original
+		if (log)
+			log->rebase(FileSignature::of(fd),folded);
+	});
+	if (log)
+		log->dropFolded();
+	if (snapshot && !saveSnapshot(name,records))
+		std::cerr<<"could not write snapshot "<<snapshotName(name)<<'\n';// the xml file is still valid
+}
+
 // read a goal record, consisting of leaf records, discarding comment entries
 // Prerequisite: parser has read the file up to a label="goal"
 
 Goal GoalContainer::readGoal( XMLParser &parser, std::string &label) {
+	return decodeGoal(parser,label);
+}
+
+Goal GoalContainer::readGoal( MappedXMLParser &parser, std::string_view label) {
+	return decodeGoal(parser,label);
+}
+
+namespace {
+
+// leaf labels of a goal record, with their closing labels so no "/"+label string is ever built
+enum GoalField {
+	FIELD_NAME=0,
+	FIELD_PRIORITY,
+	FIELD_COMPLETION,
+	FIELD_UNITCOST,
+	FIELD_UNKNOWN
+};
+
+struct FieldLabel {
+	std::string_view open;
+	std::string_view close;
+};
+
+constexpr FieldLabel fieldLabels[FIELD_UNKNOWN]={
+	{"name","/name"},
+	{"priority","/priority"},
+	{"completion","/completion"},
+	{"unitcost","/unitcost"}
+};
+
+// the leaf labels differ in their first letter, so a 26-entry table built at compile time
+// picks the only candidate and one comparison confirms it
+struct FieldTable {
+	GoalField byInitial[26];
+	constexpr FieldTable():byInitial{} {
+		for (auto &f:byInitial)
+			f=FIELD_UNKNOWN;
+		for (int f=FIELD_NAME; f<FIELD_UNKNOWN; f++)
+			byInitial[fieldLabels[f].open[0]-'a']=static_cast<GoalField>(f);
+	}
+};
+constexpr FieldTable fieldTable;
+
+constexpr GoalField lookupField( std::string_view label ) {
+	if (label.empty() || label[0]<'a' || label[0]>'z')
+		return FIELD_UNKNOWN;
+	GoalField f=fieldTable.byInitial[label[0]-'a'];
+	return (f!=FIELD_UNKNOWN && fieldLabels[f].open==label)? f : FIELD_UNKNOWN;
+}
+static_assert(lookupField("completion")==FIELD_COMPLETION && lookupField("unit")==FIELD_UNKNOWN,
+		"leaf label table is inconsistent");
+
+// true if closing is "/"+label
+bool isClosingLabel( std::string_view closing, std::string_view label ) {
+	return closing.size()==label.size()+1 && closing[0]=='/' && closing.substr(1)==label;
+}
+
+// locale-independent number conversion. like stoi/stod leading whitespace and a '+' are accepted
+// and trailing characters ignored, but nothing is allocated unless the number is invalid
+template <class T>
+T parseNumber( std::string_view data, std::string_view label ) {
+	const char* first=data.data();
+	const char* last=first+data.size();
+	while (first<last && (*first==' ' || *first=='\t'))
+		first++;
+	if (first<last && *first=='+')
+		first++;
+	T value{};
+	auto res=std::from_chars(first,last,value);
+	if (res.ec!=std::errc())
+		throw(std::runtime_error(std::string{label}+": invalid number ["+std::string{data}+"]"));
+	return value;
+}
+
+// priority and completion are percentages, see GoalColumns. A value outside 0 to 100 written by
+// an earlier version is read as the nearest bound, failing the load would lose the records after it
+int parsePercent( std::string_view data, std::string_view label ) {
+	int value=parseNumber<int>(data,label);
+	int percent=GoalColumns::clampPercent(value);
+	if (percent!=value)
+		std::cerr<<label<<": out of range ["<<data<<"], read as "<<percent<<'\n';
+	return percent;
+}
+
+} // namespace
+
+// decodes the leaves of a goal record. with the mapped parser the labels and data are views into
+// the file, so the only allocation is the goal's name when it does not fit the short string buffer
+
+template <class Parser>
+Goal GoalContainer::decodeGoal( Parser &parser, std::string_view label) {
 	Goal goal;
-	std::string leafLabel=parser.getLabel();
-	std::string endLabel{"/"};
-	endLabel+=label;		// forming the /goal ending label.
+	auto leafLabel=parser.getLabel();
 	
-	while (leafLabel != endLabel && parser.moreToGo()) {
-		std::string data=parser.getLeafData();
-		if (leafLabel == "name")
-			goal.name=data; // would a move be more efficient or is it done implicitly?
-		else if (leafLabel == "priority")
-		       goal.priority = std::stoi(data); 
-		else if (leafLabel == "completion")
-			goal.completion = std::stoi(data);
-		else if (leafLabel == "unitcost")
-			goal.unitcost = std::stod(data);
-		else throw(std::runtime_error(leafLabel +": unknown label in leaf data"));	
-		std::string dataEnd{"/"+leafLabel};
-		if (parser.getLabel() !=dataEnd)
-			throw( std::runtime_error(leafLabel +": Leaf data label does not close properly"));
+	while (!isClosingLabel(leafLabel,label) && parser.moreToGo()) {
+		auto data=parser.getLeafData();
+		GoalField field=lookupField(leafLabel);
+		switch (field) {
+			case FIELD_NAME: goal.name=data; break;
+			case FIELD_PRIORITY: goal.priority=parsePercent(data,leafLabel); break;
+			case FIELD_COMPLETION: goal.completion=parsePercent(data,leafLabel); break;
+			case FIELD_UNITCOST: goal.unitcost=parseNumber<double>(data,leafLabel); break;
+			default: throw(std::runtime_error(std::string{leafLabel} +": unknown label in leaf data"));
+		}
+		if (parser.getLabel() !=fieldLabels[field].close)
+			throw( std::runtime_error(std::string{leafLabel} +": Leaf data label does not close properly"));
 		leafLabel=parser.getLabel();// if it throws, will be caught by openfile
 	}
 	return goal;
@@ -135,15 +558,20 @@ Goal GoalContainer::readGoal( XMLParser &parser, std::string &label) {
 //write a whole goal entry
 
 void GoalContainer::writeGoal( XMLWriter& writer, const Goal& goal) {
-	static char buf[30];
 	writer.openLabel("goal",true);
 	writer.writeLeaf("name",goal.name);
-	writer.writeLeaf("priority",std::to_string(goal.priority));
-	writer.writeLeaf("completion",std::to_string(goal.completion));
-
-	sprintf(buf,"%.2lf",goal.unitcost);
+	writer.writeLeaf("priority",goal.priority);
+	writer.writeLeaf("completion",goal.completion);
+	writer.writeLeaf("unitcost",goal.unitcost,2);
+	writer.closeLabel();// goal
+}
 
-	writer.writeLeaf("unitcost",buf);
+void GoalContainer::writeGoal( XMLWriter& writer, const GoalColumns& records, int idx) {
+	writer.openLabel("goal",true);
+	writer.writeLeaf("name",records.name(idx));
+	writer.writeLeaf("priority",records.priority(idx));
+	writer.writeLeaf("completion",records.completion(idx));
+	writer.writeLeaf("unitcost",records.unitcost(idx),2);
 	writer.closeLabel();// goal
 }
 
@@ -151,95 +579,360 @@ void GoalContainer::writeGoal( XMLWriter& writer, const Goal& goal) {
 void GoalContainer::searchGoals() {
 	if (!refreshSearch && searchver == UserOptions::getInstance().getSearchVer())//no need to re-search
 		return;
-	searchRes.clear();
-	for (auto idx:active)//always load from active to exclude deleted records
-		if (matchGoal(idx))
-			searchRes.insert(searchRes.end(),idx);//hint
+	const SearchCriteria &criteria=UserOptions::getInstance().getSearchCriteria();
+	const NameMatcher &nameFilter=currentMatcher();
+	searchRes.reset();
+	// every filter backed by an index offers the live records it admits, read off by a range scan.
+	// The smallest offer is verified against all the filters. Offers above a quarter of the active
+	// records lose to a sequential pass over them, which reads the columns in order
+	enum { FROM_ACTIVE, FROM_PRIORITY, FROM_COMPLETION, FROM_COST, FROM_NAME } source=FROM_ACTIVE;
+	size_t activeRecords=activesize();
+	size_t smallest=activeRecords/4;
+	auto offer=[&]( size_t records, auto from ) {
+		if (records<smallest) {
+			smallest=records;
+			source=from;
+		}
+	};
+	if (criteria.filtersPriority())
+		offer(byPriority.count(criteria.minPriority,criteria.maxPriority),FROM_PRIORITY);
+	if (criteria.filtersCompletion())
+		offer(byCompletion.count(criteria.minCompletion,criteria.maxCompletion),FROM_COMPLETION);
+	std::pair<const int*,const int*> costs;
+	if (criteria.filtersCost()) {
+		costs=byCost.between(criteria.costFloor(),criteria.maxCost,[&]( auto f ) { active.forEach(f); });
+		offer(costs.second-costs.first,FROM_COST);
+	}
+	std::vector<int> nameHits;	// records holding every trigram of the filter's literal
+	if (useTrigrams && byTrigram.candidates(nameFilter.required(),nameHits,[&]( auto f ) { active.forEach(f); }))
+		offer(nameHits.size(),FROM_NAME);
+
+	auto verify=[&]( int idx ) {
+		if (matchFields(idx,criteria,nameFilter))
+			searchRes.set(idx);
+	};
+	// the full pass fills whole words of searchRes from the same words of active, so ranges of
+	// words are independent and each task writes only its own
+	auto verifyWords=[&]( size_t first, size_t last ) {
+		for (size_t w=first;w<last;w++) {
+			uint64_t hits=0;
+			for (uint64_t members=active.word(w); members; members&=members-1) {
+				int bit=__builtin_ctzll(members);
+				if (matchFields(w*64+bit,criteria,nameFilter))
+					hits|=uint64_t(1)<<bit;
+			}
+			searchRes.word(w)=hits;
+		}
+	};
+	auto scanBuckets=[&]( const BucketIndex &index, int lo, int hi ) {
+		for (int value=lo;value<=hi;value++)
+			for (int idx:index.bucket(value))
+				verify(idx);
+	};
+	switch (source) {
+		case FROM_PRIORITY:
+			scanBuckets(byPriority,criteria.minPriority,criteria.maxPriority);
+			break;
+		case FROM_COMPLETION:
+			scanBuckets(byCompletion,criteria.minCompletion,criteria.maxCompletion);
+			break;
+		case FROM_COST:
+			std::for_each(costs.first,costs.second,verify);
+			break;
+		case FROM_NAME:
+			std::for_each(nameHits.begin(),nameHits.end(),verify);
+			break;
+		default: {	//always load from active to exclude deleted records
+			ThreadPool &pool=ThreadPool::getInstance();
+			size_t words=active.wordCount();
+			if (pool.size()<2 || activeRecords<(size_t)UserOptions::getInstance().getParallelSearchMin())
+				verifyWords(0,words);
+			else {
+				size_t chunks=pool.size()*4;	// a few per thread, as name filters vary in cost
+				pool.run(chunks,[&]( size_t c ) {
+					verifyWords(words*c/chunks,words*(c+1)/chunks);
+				});
+			}
+		}
+	}
 	searchver=UserOptions::getInstance().getSearchVer();
 	refreshSearch=false;
 	refreshSort=true;//since we updated search results, we need to update the presented records
 }	
 
-bool GoalContainer::matchGoal( int gidx ) {
-	return matchGoal(gidx, UserOptions::getInstance().getSearchCriteria());
+// recompiled only when the search criteria change, inserts and searches share it
+const NameMatcher& GoalContainer::currentMatcher() {
+	UserOptions &options=UserOptions::getInstance();
+	if (matcherver!=options.getSearchVer()) {
+		if (options.getSearchCriteria().name!=matcher.pattern())
+			matcher=NameMatcher{options.getSearchCriteria().name};
+		matcherver=options.getSearchVer();
+	}
+	return matcher;
 }
 
-bool GoalContainer::matchGoal( int gidx, const Goal& searchCriteria ) {
-	bool matched=true;
-	if (!searchCriteria.name.empty()) {
-		std::regex re(searchCriteria.name);
-		matched=std::regex_search(v[gidx].name,re);//search for regular expression
-	}
-	if (matched && searchCriteria.priority!=-1)
-		matched &= ( v[gidx].priority ==searchCriteria.priority);
+bool GoalContainer::matchGoal( int gidx ) {
+	return matchFields(gidx, UserOptions::getInstance().getSearchCriteria(), currentMatcher());
+}
 
-	if (matched && searchCriteria.completion!=-1)
-		matched &= ( v[gidx].completion ==searchCriteria.completion);
+bool GoalContainer::matchGoal( int gidx, const SearchCriteria& criteria ) {
+	if (criteria.name==currentMatcher().pattern())
+		return matchFields(gidx,criteria,matcher);
+	return matchFields(gidx,criteria,NameMatcher{criteria.name});
+}
 
-	if (matched && searchCriteria.unitcost>-1.)
-		matched &= (v[gidx].unitcost == searchCriteria.unitcost);
-	return matched;
+// the numbers are compared first, they are cheaper than any name filter
+bool GoalContainer::matchFields( int gidx, const SearchCriteria& criteria, const NameMatcher &nameFilter ) const {
+	int priority=v.priority(gidx);
+	int completion=v.completion(gidx);
+	double unitcost=v.unitcost(gidx);
+	return priority>=criteria.minPriority && priority<=criteria.maxPriority &&
+		completion>=criteria.minCompletion && completion<=criteria.maxCompletion &&
+		unitcost>=criteria.costFloor() && unitcost<=criteria.maxCost &&
+		nameFilter.matches(v.name(gidx));//literal search, or the regular expression
 }
 
-// Estblishes the new order of v's indices based on the new sorting string
-// by utilizing a recursive comparator
+// Establishes the new order of v's indices based on the new sorting string, compiled once into
+// a SortSpec and compared through the KeyedLess of its leading key, see withKeyedLess()
 // Note: may be called after an insert or deletion so re-creating the sorted vector is necessary
+// With paging on only a page is shown at a time, the ordering is left to ensureSorted() as
+// records are asked for
 
 void GoalContainer::sortGoals() {
 	if ( !refreshSort  &&  sortver==UserOptions::getInstance().getSortingVer())//no reordering needed
 		return;
-	sorted.clear();		//will contains the sequence of indices of live goals in v, post filtering
-				//when properly ordered based on user's sorting criteria
-	for (int idx:searchRes) 
+	UserOptions &options=UserOptions::getInstance();
+	const SortSpec &spec=currentSortSpec();
+	SortCache::Key key{options.getSortPrefs(),options.getSearchCriteria(),dataver};
+	// the view being left is kept while it matches the records, file order is rebuilt cheaply
+	if (viewKey.dataver==dataver && !viewKey.prefs.empty())
+		sortCache.put(std::move(viewKey),std::move(sorted),sortedPrefix,size_t(options.getSortCacheMB())<<20);
+	viewKey=key;
+	if (!sortCache.take(key,sorted,sortedPrefix)) {	// a cached order may be partly sorted too
+		sorted.clear();		//will contains the sequence of indices of live goals in v, post filtering
+					//when properly ordered based on user's sorting criteria
+		sorted.reserve(searchRes.count());
+		searchRes.forEach([&]( int idx ) {
+			sorted.push_back(idx);
+		});
+		// an empty spec is file order, which searchRes already gave
+		sortedPrefix= spec.size()>0? 0 : sorted.size();
+	}
+	if (!options.getPaging())
+		ensureSorted(sorted.size());
+	sortver=options.getSortingVer();
+	refreshSort=false;
+}
+
+// every edit makes the cached orderings stale. The view's key follows the records while each
+// edit is placed into sorted by the search it was built for, otherwise sorted is rebuilt and
+// not worth caching
+void GoalContainer::recordsChanged( bool viewPatched ) {
+	sortCache.clear();
+	bool current= viewPatched && viewKey.dataver==dataver &&
+		viewKey.criteria==UserOptions::getInstance().getSearchCriteria();
+	dataver++;
+	if (current)
+		viewKey.dataver=dataver;
+}
+
+// Orders sorted until its first count entries are final. nth_element leaves everything past the
+// ordered prefix behind it, so a later call only works on the rest: the first page costs
+// O(n + k log k). Each extension at least doubles the prefix, paging through all of it stays
+// O(n log n). Numeric leading keys are radix sorted, see radixsort.h, and a large result sorted
+// in one go is sorted in runs on the pool and merged
+void GoalContainer::ensureSorted( size_t count ) {
+	count=std::min(count,sorted.size());
+	if (count<=sortedPrefix)
+		return;
+	size_t target=std::max(count,2*sortedPrefix);
+	if (target>sorted.size()/2)
+		target=sorted.size();	// what is left is cheaper sorted outright
+	const SortSpec &spec=sortSpec;	// compiled by sortGoals()
+	withKeyedLess(v,spec,[&]( auto less ) {
+		auto sortRun=[&]( int *first, int *last ) {
+			if (!radixSort(first,last,v,spec))
+				std::sort(first,last,less);
+		};
+		int *first=sorted.data()+sortedPrefix;
+		int *mid=sorted.data()+target;
+		ThreadPool &pool=ThreadPool::getInstance();
+		if (target<sorted.size()) {
+			std::nth_element(first,mid,sorted.data()+sorted.size(),less);
+			sortRun(first,mid);
+		}
+		else if (sortedPrefix>0 || pool.size()<2 ||
+				sorted.size()<(size_t)UserOptions::getInstance().getParallelSortMin())
+			sortRun(first,mid);
+		else
+			parallelSort(sorted,sortRun,less,pool);
+	});
+	sortedPrefix=target;
+}
+
+// sorted holds searchRes in the current sort order, so single edits can keep it that way
+bool GoalContainer::viewIsCurrent() {
+	return !refreshSort && !loading && sortver==UserOptions::getInstance().getSortingVer();
+}
+
+// the comparator breaks ties by index, so every record has exactly one place in sorted. One that
+// sorts after the ordered prefix joins the unordered rest
+void GoalContainer::placeSorted( int idx ) {
+	GoalComparator less{this};
+	auto prefixEnd=sorted.begin()+sortedPrefix;
+	if (prefixEnd==sorted.end() || (sortedPrefix>0 && less(idx,sorted[sortedPrefix-1]))) {
+		sorted.insert(std::upper_bound(sorted.begin(),prefixEnd,idx,less),idx);
+		sortedPrefix++;
+	}
+	else
 		sorted.push_back(idx);
-	GoalComparator comp{this}; // build a comparator object to act on this container
+}
 
-	std::sort(sorted.begin(),sorted.end(),comp);
-	sortver=UserOptions::getInstance().getSortingVer();
-	refreshSort=false;
+// idx must still hold the values it was placed with
+void GoalContainer::unplaceSorted( int idx ) {
+	auto prefixEnd=sorted.begin()+sortedPrefix;
+	auto it=std::lower_bound(sorted.begin(),prefixEnd,idx,GoalComparator{this});
+	if (it!=prefixEnd && *it==idx) {
+		sorted.erase(it);
+		sortedPrefix--;
+	}
+	else {
+		it=std::find(prefixEnd,sorted.end(),idx);
+		if (it!=sorted.end())
+			sorted.erase(it);
+	}
 }
 
 // confirm id in current displayed set.
 bool GoalContainer::checkRecordID( int recordID ) {
-	return (recordID>=0 && recordID<sorted.size());
+	if (recordID<0 || recordID>=sorted.size())
+		return false;
+	ensureSorted(recordID+1);	// it may lie past the pages shown so far
+	return true;
 }
 
 // remove from active goal record set.
 bool GoalContainer::deleteRecord( int recordID ) {
+	ensureSorted(recordID+1);
 	int globalID=sorted[recordID]; 		// get the absolute record ID
 	try {
-	active.erase(globalID);			//remove from active records
-	} catch ( std::exception e) {
+		removeGoal(globalID);
+	} catch ( std::exception &e) {
 		std::cerr<<"error while deleting goal:"<<e.what()<<'\n';
 		return false;
 	}
-	names.erase(v[globalID].name);		// remove goal name from used name set
-	searchRes.erase(globalID);		// remove from search results, no update necessary
 	sorted.erase(sorted.begin()+recordID);// removing the record will not necessitate a new sorting
+	sortedPrefix--;
 						// dependend records should be reloaded, but is wasteful.
-	modifiedGoals=true;			//changes made, should ask about saving on exit 
+	compactIfNeeded();
 	return true;
 }
 
+// compacts once deleted records exceed compactionRatio of v. each compaction removes them all,
+// so its linear cost is spread over at least compactionRatio*size() deletions
+void GoalContainer::compactIfNeeded() {
+	size_t deleted=v.size()-active.count();
+	if (deleted>0 && deleted > compactionRatio*v.size())
+		compact();
+}
+
+// rebuilds v with the live records in their original order, which also releases the arena space
+// of replaced names. A single pass over the old indices renumbers names, searchRes and sorted,
+// so neither the search nor the sort has to be redone.
+
+void GoalContainer::compact() {
+	std::vector<int> newIndex(v.size(),-1);
+	GoalColumns live;
+	live.reserve(active.count());
+	active.forEach([&]( int idx ) {
+		newIndex[idx]=live.size();
+		live.push_back(v,idx);
+	});
+	DynamicBitset liveResults(live.size());
+	searchRes.forEach([&]( int idx ) {
+		liveResults.set(newIndex[idx]);
+	});
+	recordsChanged(true);	// sorted is renumbered below, cached orders are not
+	for (auto &idx:sorted)
+		idx=newIndex[idx];
+	sortedPrefix-=std::count(sorted.begin(),sorted.begin()+sortedPrefix,-1);
+	sorted.erase(std::remove(sorted.begin(),sorted.end(),-1),sorted.end());
+	v=std::move(live);	// names keeps reading v's name column, now holding the live names
+	names.remap(newIndex);
+	byPriority.remap(newIndex);
+	byCompletion.remap(newIndex);
+	byCost.remap(newIndex);
+	byTrigram.remap(newIndex);
+	active.clear();
+	active.resize(v.size());
+	active.set();
+	searchRes=std::move(liveResults);
+}
+
+void GoalContainer::removeGoal( int globalID ) {
+	logEdit(JournalEntry{JournalEntry::OP_DELETE,std::string{v.name(globalID)}});
+	active.reset(globalID);			//remove from active records
+	names.erase(v.name(globalID));		// remove goal name from used name set
+	byPriority.remove(v.priority(globalID),globalID);
+	byCompletion.remove(v.completion(globalID),globalID);
+	byCost.remove(globalID);
+	byTrigram.remove(globalID);
+	v.retire(globalID);
+	searchRes.reset(globalID);		// remove from search results, no update necessary
+	if (loading)
+		refreshSort=true;		// replaying, sorted is built afterwards
+	recordsChanged(!loading);		// deleteRecord() takes it out of sorted
+	modifiedGoals=true;			//changes made, should ask about saving on exit 
+}
+
 //modifies a goal record given its record id and new values. attentds to index and sorting updating
 bool GoalContainer::modifyRecord( int recordID, const Goal& newvals ) {
+	ensureSorted(recordID+1);
 	int globalID = sorted[recordID];
 
+	if (!GoalColumns::inRange(newvals))
+		return false;
 	int idx=findNameIndex( newvals.name );
 	if (idx>=0 && idx != globalID ) // another goal with the same name exists
 		return false;
-	if (idx<0) // a new name
-		names.erase(v[globalID].name); // remove from the names map
-	v[globalID]=newvals;		// change the goal record
-	if (idx<0)
-		names.insert(make_pair(newvals.name,globalID)); // re-insert into names map
-	if (!matchGoal(globalID))
-		searchRes.erase(globalID);//remove from search results, if no longer matching
-	refreshSort=true; 
-	modifiedGoals=true;
+	modifyGoal(globalID,newvals);
 	return true;
 }
 
+void GoalContainer::modifyGoal( int globalID, const Goal& newvals ) {
+	logEdit(JournalEntry{JournalEntry::OP_MODIFY,std::string{v.name(globalID)},newvals});
+	bool current=viewIsCurrent();
+	if (current && searchRes.test(globalID))
+		unplaceSorted(globalID);	// found by the values it was sorted with
+	bool renamed= (newvals.name!=v.name(globalID));
+	if (renamed) // a new name
+		names.erase(v.name(globalID)); // remove from the names index
+	byPriority.remove(v.priority(globalID),globalID);
+	byCompletion.remove(v.completion(globalID),globalID);
+	byCost.remove(globalID);
+	if (renamed)
+		byTrigram.remove(globalID);
+	v.set(globalID,newvals);	// change the goal record
+	if (renamed) {
+		names.insert(v.name(globalID),globalID); // re-insert into names index
+		byTrigram.add(globalID);
+	}
+	byPriority.add(newvals.priority,globalID);
+	byCompletion.add(newvals.completion,globalID);
+	byCost.add(globalID);
+	bool visible=matchGoal(globalID);	// the record may leave the search results or join them
+	if (visible)
+		searchRes.set(globalID);
+	else
+		searchRes.reset(globalID);
+	if (!current)
+		refreshSort=true; 
+	else if (visible)
+		placeSorted(globalID);
+	recordsChanged(current);
+	modifiedGoals=true;
+}
+
 //returns in copy the values of the original record, identified by record ID
 int GoalContainer::getGoalByRecordID( int recordID , Goal& copy) {
 	if (checkRecordID(recordID)) {
@@ -251,45 +944,61 @@ int GoalContainer::getGoalByRecordID( int recordID , Goal& copy) {
 }
 
 //returns the index of the name in v if found, -1 if not	
-int GoalContainer::findNameIndex( const std::string& name ) const{
-	auto res=names.find(name);
-	if (res !=names.end())
-		return res->second;// the index of the goal record in V
-	return -1;//non-existent
-}
-// comparator objects function operator, to be called recursively from std::sort and work based on depth and 
-// comparison preferences string in GoalContainer
-// Note: using a static to mark recursive use of the sorting string
-
-bool GoalComparator::operator()( const int &a, const int &b ) {
-	static int depth=0;	//progressing by pair of characters 
-	
-	if (depth==UserOptions::getInstance().sortPrefs.length()) 	// no remaining sort fields, 
-		return a<b;			//return physical file order of records 
-	char c=UserOptions::getInstance().sortPrefs[depth];
-	char o=UserOptions::getInstance().sortPrefs[depth+1];
-	bool lt,eq; 
-	switch (c) {
-		case 'n': lt=( gc->v[a].name < gc->v[b].name );
-			  eq=( gc->v[a].name == gc->v[b].name ); 
-			  break;
-		case 'p': lt=( gc->v[a].priority < gc->v[b].priority );
-			  eq=( gc->v[a].priority == gc->v[b].priority ); 
-			  break;
-		case 'c': lt=( gc->v[a].completion < gc->v[b].completion );
-			  eq=( gc->v[a].completion == gc->v[b].completion ); 
-			  break;
-		case 'u': lt=( gc->v[a].unitcost < gc->v[b].unitcost );
-			  eq=( gc->v[a].unitcost == gc->v[b].unitcost ); 
-			  break;
-	} 
-	if (eq) {			//fields are equal
-		depth+=2;		// mark next field, if one exists
-		bool res=(*this)(a,b);	//recursive call for the next field
-		depth-=2;
-		return res;
-	} 
-	return ( (o=='a')?lt:!lt);	//can be ordered based on this field, <less than> holds.
+int GoalContainer::findNameIndex( std::string_view name ) const{
+	return names.find(name);// the index of the goal record in V, -1 if non-existent
+}
+// compiles the sorting string into up to four keys, one per field-order pair, in the order given.
+// KeyedLess compares on them in turn and lastly on the record index, so no two records tie
+
+SortSpec::SortSpec( const std::string &prefs ):count{0} {
+	for (size_t i=0;i+1<prefs.size() && count<4;i+=2) {
+		SortKey::FIELD field;
+		switch (prefs[i]) {
+			case 'n': field=SortKey::NAME; break;
+			case 'p': field=SortKey::PRIORITY; break;
+			case 'c': field=SortKey::COMPLETION; break;
+			default: field=SortKey::UNITCOST; break;
+		}
+		keys[count++]=SortKey{field,prefs[i+1]=='d'};
+	}
+}
+
+// the oldest entries make room for order, which is not kept at all when larger than the budget.
+// A budget lowered since the last call is enforced here too
+void SortCache::put( Key key, std::vector<int> &&order, size_t prefix, size_t budget ) {
+	size_t size=order.capacity()*sizeof(int);
+	if (size>budget)
+		size=0;
+	while (!entries.empty() && used+size>budget) {
+		used-=entries.back().order.capacity()*sizeof(int);
+		entries.pop_back();
+	}
+	if (size==0)
+		return;
+	entries.push_front(Entry{std::move(key),std::move(order),prefix});
+	used+=size;
+}
+
+bool SortCache::take( const Key &key, std::vector<int> &order, size_t &prefix ) {
+	for (auto it=entries.begin();it!=entries.end();++it)
+		if (it->key==key) {
+			used-=it->order.capacity()*sizeof(int);
+			order=std::move(it->order);
+			prefix=it->prefix;
+			entries.erase(it);
+			return true;
+		}
+	return false;
+}
+
+// recompiled only when the sorting preferences change
+const SortSpec& GoalContainer::currentSortSpec() {
+	UserOptions &options=UserOptions::getInstance();
+	if (specver!=options.getSortingVer()) {
+		sortSpec=SortSpec{options.getSortPrefs()};
+		specver=options.getSortingVer();
+	}
+	return sortSpec;
 }
 
 //Load user display and sort options
@@ -311,6 +1020,16 @@ void UserOptions::loadFile( const std::string &fname) {
 				showNumbers = ( data == "true" );
 			else if (label=="sort")
 				setSortPrefs(data);
+			else if (label=="autosave")
+				setAutosave(parseNumber<int>(data,label));
+			else if (label=="threads")
+				setThreads(parseNumber<int>(data,label));
+			else if (label=="parallelsearch")
+				setParallelSearchMin(parseNumber<int>(data,label));
+			else if (label=="parallelsort")
+				setParallelSortMin(parseNumber<int>(data,label));
+			else if (label=="sortcache")
+				setSortCacheMB(parseNumber<int>(data,label));
 			else throw (std::runtime_error(label+" :unknown leaf label in "+fname));
 			std::string dataend{ "/"+label};
 			label = parser.getLabel();
@@ -324,11 +1043,9 @@ void UserOptions::loadFile( const std::string &fname) {
 	}
 }
 
-// Write user options to xml file after creating a backup of the original
+// Write user options to xml file, keeping the original as a backup
 void UserOptions::writeFile() {
-	std::cerr<<"creating options backup file "<<filename<<".bak\n";
-	system( ("cp "+filename+" "+filename+".bak -f").c_str() );
-	std::cerr<<"saving to "<<filename<<"...\n";
+	std::cerr<<"saving to "<<filename<<", previous options kept as "<<filename<<".bak\n";
 	try{
 		XMLWriter writer{filename};
 		writer.writeHeader();
@@ -337,7 +1054,13 @@ void UserOptions::writeFile() {
 		writer.writeLeaf("paging",(paging?"true":"false"));
 		writer.writeLeaf("numbers",(showNumbers?"true":"false"));
 		writer.writeLeaf("sort",sortPrefs);
+		writer.writeLeaf("autosave",autosave);
+		writer.writeLeaf("threads",threads);
+		writer.writeLeaf("parallelsearch",parallelSearchMin);
+		writer.writeLeaf("parallelsort",parallelSortMin);
+		writer.writeLeaf("sortcache",sortCacheMB);
 		writer.closeLabel();
+		writer.flush(true);
 	} catch (std::exception& e) {
 		std::cerr<<"Exception caught while saving file:"<<e.what()<<"\n";
 		}
@@ -396,15 +1119,119 @@ void UserOptions::setSortPrefs(std::string newPrefs) {
 
 //called by the options search menu. checks and sets new values to the search criteria
 
-void UserOptions::setSearchCriteria( Goal newCriteria) {
-	if (newCriteria.priority<0 || newCriteria.priority>100)
-		newCriteria.priority=-1;
-	if (newCriteria.completion<0 || newCriteria.completion>100)
-		newCriteria.completion=-1;
-	if (newCriteria.unitcost<0.00000001)
-		newCriteria.unitcost=-1.;
+void UserOptions::setSearchCriteria( SearchCriteria newCriteria) {
+	// bounds past what a field can hold filter nothing more. an inverted range is kept, it matches no record
+	newCriteria.minPriority=std::max(newCriteria.minPriority,0);
+	newCriteria.maxPriority=std::min(newCriteria.maxPriority,100);
+	newCriteria.minCompletion=std::max(newCriteria.minCompletion,0);
+	newCriteria.maxCompletion=std::min(newCriteria.maxCompletion,100);
+	newCriteria.minCost=std::max(newCriteria.minCost,0.);
 	if (newCriteria == searchCriteria)
 		return;
 	searchCriteria=newCriteria;
 	searchver++; // like sorting, indicate need to refresh search results
 }
+
+SearchCriteria::SearchCriteria( const Goal &equalTo ):SearchCriteria{} {
+	name=equalTo.name;
+	if (equalTo.priority!=-1)
+		minPriority=maxPriority=equalTo.priority;
+	if (equalTo.completion!=-1)
+		minCompletion=maxCompletion=equalTo.completion;
+	if (equalTo.unitcost>-1.)
+		minCost=maxCost=equalTo.unitcost;
+}
+
+std::ostream& SearchCriteria::print( std::ostream &strm ) const {
+	strm<<std::setfill(' ')<<std::setw(40)<<name;
+	strm<<std::setw(9)<<rangeText(minPriority,maxPriority,0,100);
+	strm<<std::setw(12)<<rangeText(minCompletion,maxCompletion,0,100);
+	strm<<std::setw(7)<<""<<rangeText(minCost,maxCost,0.,HUGE_VAL)<<'\n';
+	return strm;
+}
+
+namespace {
+
+// the nearest values past a strict bound
+int above( int x ) { return x+1; }
+int below( int x ) { return x-1; }
+double above( double x ) { return std::nextafter(x,HUGE_VAL); }
+double below( double x ) { return std::nextafter(x,-HUGE_VAL); }
+
+template <class T>
+bool wholeNumber( std::string_view text, T &value ) {
+	auto res=std::from_chars(text.data(),text.data()+text.size(),value);
+	return res.ec==std::errc() && res.ptr==text.data()+text.size();
+}
+
+// where an x-y range splits: the first '-' that neither signs its first number nor an exponent
+size_t rangeDash( std::string_view text ) {
+	for (size_t i=1;i<text.size();i++)
+		if (text[i]=='-' && text[i-1]!='e' && text[i-1]!='E')
+			return i;
+	return std::string_view::npos;
+}
+
+} // namespace
+
+template <class T>
+bool SearchCriteria::parseRange( std::string_view input, T &lo, T &hi, T min, T max ) {
+	std::string text;
+	for (char c:input)
+		if (!isspace(static_cast<unsigned char>(c)))
+			text+=c;
+	std::string_view rest{text};
+	T a, b;
+	if (text.empty() || text=="-") {
+		lo=min;
+		hi=max;
+	}
+	else if (rest.substr(0,2)==">=" || rest.substr(0,2)=="<=") {
+		if (!wholeNumber(rest.substr(2),a))
+			return false;
+		lo= (rest[0]=='>'? a : min);
+		hi= (rest[0]=='<'? a : max);
+	}
+	else if (rest[0]=='>' || rest[0]=='<') {
+		if (!wholeNumber(rest.substr(1),a))
+			return false;
+		lo= (rest[0]=='>'? above(a) : min);
+		hi= (rest[0]=='<'? below(a) : max);
+	}
+	else if (size_t dash=rangeDash(rest); dash!=std::string_view::npos) {
+		if (!wholeNumber(rest.substr(0,dash),a) || !wholeNumber(rest.substr(dash+1),b))
+			return false;
+		lo=a;
+		hi=b;
+	}
+	else {
+		if (rest[0]=='=')
+			rest.remove_prefix(1);
+		if (!wholeNumber(rest,a))
+			return false;
+		lo= (a<min? min : a);
+		hi= (a<min? max : a);
+	}
+	return true;
+}
+
+template <class T>
+std::string SearchCriteria::rangeText( T lo, T hi, T min, T max ) {
+	std::ostringstream out;
+	if (lo<=min && hi>=max)
+		out<<'-';
+	else if (lo==hi)
+		out<<lo;
+	else if (hi>=max)
+		out<<">="<<lo;
+	else if (lo<=min)
+		out<<"<="<<hi;
+	else
+		out<<lo<<'-'<<hi;
+	return out.str();
+}
+
+template bool SearchCriteria::parseRange<int>( std::string_view, int&, int&, int, int );
+template bool SearchCriteria::parseRange<double>( std::string_view, double&, double&, double, double );
+template std::string SearchCriteria::rangeText<int>( int, int, int, int );
+template std::string SearchCriteria::rangeText<double>( double, double, double, double );
@@ -0,0 +1,92 @@
+// BITSET.H
+// dense set of record indices, one bit per record of the goal container
+// Copyright 2018 Thanasis Karpetis
+//
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITSET_H
+ #define BITSET_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+// sized like the record columns, a set bit marks a member. scans walk 64 indices per word,
+// skipping empty words, and visit members in increasing order like the std::set it replaces.
+// Bits past size() are always clear, so whole-word operations need no masking.
+
+class DynamicBitset {
+	std::vector<uint64_t> words;
+	size_t bits;
+
+	static size_t wordsFor( size_t n ) { return (n+63)/64; }
+ public:
+	DynamicBitset( size_t n=0 ):words(wordsFor(n),0),bits{n} {}
+
+	size_t size() const { return bits; }
+	void resize( size_t n ) {		// added bits are clear
+		words.resize(wordsFor(n),0);
+		if (n<bits && n%64)
+			words.back()&= (uint64_t(1)<<(n%64))-1;
+		bits=n;
+	}
+	void clear() { words.clear(); bits=0; }
+	void reset() { std::fill(words.begin(),words.end(),0); } // empty the set, keep the size
+	void set() {						// every index of the size
+		std::fill(words.begin(),words.end(),~uint64_t(0));
+		if (bits%64)
+			words.back()= (uint64_t(1)<<(bits%64))-1;
+	}
+	void push_back( bool member ) {
+		if (bits%64==0)
+			words.push_back(0);
+		if (member)
+			words.back()|= uint64_t(1)<<(bits%64);
+		bits++;
+	}
+
+	bool test( size_t i ) const { return words[i/64]>>(i%64) & 1; }
+	void set( size_t i ) { words[i/64]|= uint64_t(1)<<(i%64); }
+	void reset( size_t i ) { words[i/64]&= ~(uint64_t(1)<<(i%64)); }
+
+	size_t count() const {
+		size_t n=0;
+		for (auto w:words)
+			n+=__builtin_popcountll(w);
+		return n;
+	}
+	bool any() const {
+		for (auto w:words)
+			if (w)
+				return true;
+		return false;
+	}
+
+	// intersection and union with a set of the same size
+	DynamicBitset& operator &=( const DynamicBitset &other ) {
+		for (size_t i=0;i<words.size();i++)
+			words[i]&=other.words[i];
+		return *this;
+	}
+	DynamicBitset& operator |=( const DynamicBitset &other ) {
+		for (size_t i=0;i<words.size();i++)
+			words[i]|=other.words[i];
+		return *this;
+	}
+
+	// calls f(index) for every member, in increasing order
+	template <class F>
+	void forEach( F f ) const {
+		for (size_t w=0;w<words.size();w++)
+			for (uint64_t bitsLeft=words[w]; bitsLeft; bitsLeft&=bitsLeft-1)
+				f(w*64+__builtin_ctzll(bitsLeft));
+	}
+
+	size_t wordCount() const { return words.size(); }
+	uint64_t word( size_t w ) const { return words[w]; }
+	uint64_t& word( size_t w ) { return words[w]; } // callers keep bits past size() clear
+};
+
+#endif
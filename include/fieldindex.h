@@ -0,0 +1,73 @@
+// FIELDINDEX.H
+// secondary indexes answering range filters on priority, completion and unitcost
+// Copyright 2018 Thanasis Karpetis
+//
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef FIELDINDEX_H
+ #define FIELDINDEX_H
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+//======== BucketIndex ======================================
+// one posting list per value of a field limited to 0..100, holding the indices of the live
+// records with that value in increasing order. New records have the highest index so inserting
+// appends, a modification or deletion costs a search within one bucket
+
+class BucketIndex {
+	std::vector<std::vector<int>> buckets;
+ public:
+	static const int values=101;
+
+	BucketIndex():buckets(values) {}
+
+	void add( int value, int idx );
+	void remove( int value, int idx );
+	const std::vector<int>& bucket( int value ) const { return buckets[value]; }
+	size_t count( int lo, int hi ) const;	// records with a value in [lo,hi]
+	// records were renumbered in order, see GoalContainer::compact(). -1 marks a dropped record
+	void remap( const std::vector<int> &newIndex );
+	void clear();
+	void reserve( size_t records ); // room for records spread evenly over the values
+};
+
+//======== CostIndex ========================================
+// the live records ordered by (unitcost,index), so the records of a range of unitcosts are
+// contiguous and those of one unitcost are in increasing order.
+// Bulk loads leave it unbuilt, the first query sorts it once, and from then on edits keep it in
+// order with a binary search and an insertion
+
+class CostIndex {
+	std::vector<int> order;
+	bool built;
+	const std::vector<double> &costs;	// the unitcost column
+
+	bool less( int a, int b ) const { return costs[a]<costs[b] || (costs[a]==costs[b] && a<b); }
+	void build();				// sort order, which holds the live records
+	std::pair<const int*,const int*> range( double lo, double hi ) const;
+ public:
+	CostIndex( const std::vector<double> &column ):built{false},costs{column} {}
+
+	// call remove() before the record's cost changes or it is deleted, and add() once it is set
+	void add( int idx );
+	void remove( int idx );
+	// the indices of the records costing from lo to hi inclusive, by cost. forEachLive(f) calls
+	// f for every live record, used to build the index on first use
+	template <class Members>
+	std::pair<const int*,const int*> between( double lo, double hi, Members forEachLive ) {
+		if (!built) {
+			order.clear();
+			forEachLive([&]( int idx ) { order.push_back(idx); });
+			build();
+		}
+		return range(lo,hi);
+	}
+	// records were renumbered in order, see GoalContainer::compact(). -1 marks a dropped record
+	void remap( const std::vector<int> &newIndex );
+	void clear() { order.clear(); built=false; }
+};
+
+#endif
@@ -1,6 +1,6 @@
 // GOALS.H
 // class declarations of Goals, GoalContainer, GoalComparator,
-// 			 XMLParser, XMLWriter and UserOptions 
+// 			 XMLParser, MappedXMLParser, XMLWriter and UserOptions 
 // for the Goals application.
 // Copyright 2018 Thanasis Karpetis
 //
@@ -15,9 +15,24 @@
 #include <iomanip>
 #include <set>
 #include <map>
-#include <regex>
+#include <list>
+#include <memory>
+#include <string_view>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+#include <cmath>
+#include "bitset.h"
+#include "names.h"
+#include "fieldindex.h"
+#include "matcher.h"
 
 class XMLParser;
+class MappedXMLParser;
+class MappedFile;
+class Journal;
+struct JournalEntry;
+class SaveWorker;
 class XMLWriter;
 class UserOptions;
 
@@ -50,52 +65,312 @@ struct Goal {
 
 std::ostream& operator <<( std::ostream& out, const Goal& goal);
 
+//==========SearchCriteria==================================
+// the filter deciding which records are shown: a name pattern and an inclusive range for each
+// numeric field. A range covering every value the field can hold leaves that field unfiltered
+
+struct SearchCriteria {
+	std::string name;	// regex or literal, see matcher.h. empty matches every name
+	int minPriority, maxPriority;
+	int minCompletion, maxCompletion;
+	double minCost, maxCost;
+
+	SearchCriteria():minPriority{0},maxPriority{100},minCompletion{0},maxCompletion{100},
+		minCost{0.},maxCost{HUGE_VAL} {}
+	explicit SearchCriteria( const Goal &equalTo ); // equality on the fields of equalTo that are not -1
+
+	bool filtersPriority() const { return minPriority>0 || maxPriority<100; }
+	bool filtersCompletion() const { return minCompletion>0 || maxCompletion<100; }
+	bool filtersCost() const { return minCost>0. || maxCost<HUGE_VAL; }
+	// a minCost of 0 bounds nothing, costs below it read from a file are not hidden
+	double costFloor() const { return minCost>0.? minCost : -HUGE_VAL; }
+	bool isEmpty() const { return name.empty() && !filtersPriority() && !filtersCompletion() && !filtersCost(); }
+
+	bool operator ==( const SearchCriteria &other ) const {
+		return name==other.name && minPriority==other.minPriority && maxPriority==other.maxPriority &&
+			minCompletion==other.minCompletion && maxCompletion==other.maxCompletion &&
+			minCost==other.minCost && maxCost==other.maxCost;
+	}
+	bool operator !=( const SearchCriteria &other ) const { return !(*this==other); }
+
+	std::ostream& print( std::ostream &strm ) const; // lined up with Goal::print()
+
+	// reads "x", ">x", ">=x", "<x", "<=x" or "x-y" into an inclusive range of [min,max]. Empty text,
+	// "-" or a single value below min (the "-1 to disable" of earlier versions) select all of it.
+	// false, leaving lo and hi alone, if text is none of these
+	template <class T>
+	static bool parseRange( std::string_view text, T &lo, T &hi, T min, T max );
+	template <class T>
+	static std::string rangeText( T lo, T hi, T min, T max ); // the reverse, "-" for all of [min,max]
+};
+
+//========= GoalColumns =====================================
+// goal records stored field by field, so filtering or sorting on a number reads only that number's
+// column instead of dragging every name through the cache. priority and completion are 0 to 100
+// and fit a byte each. Names are views into an arena owned by the columns
+
+class GoalColumns {
+	NameArena arena;
+	std::vector<std::string_view> names;
+	std::vector<uint8_t> priorities;
+	std::vector<uint8_t> completions;
+	std::vector<double> unitcosts;
+ public:
+	static bool inRange( const Goal &goal ) { // values a column can hold
+		return goal.priority>=0 && goal.priority<=100 && goal.completion>=0 && goal.completion<=100;
+	}
+	static int clampPercent( int value ) { return value<0? 0 : (value>100? 100 : value); }
+	static Goal clamped( Goal goal ) { // the nearest goal inRange()
+		goal.priority=clampPercent(goal.priority);
+		goal.completion=clampPercent(goal.completion);
+		return goal;
+	}
+
+	size_t size() const { return names.size(); }
+	void clear();
+	void reserve( size_t n );
+	void push_back( const Goal &goal );	// goal must be inRange()
+	void push_back( const GoalColumns &from, int idx ); // copies record idx of another store
+	void set( int idx, const Goal &goal );	// goal must be inRange()
+	void retire( int idx ) { arena.drop(names[idx]); } // record deleted, its name stays readable
+	Goal operator []( int idx ) const {	// a copy of the whole record
+		return Goal{std::string{names[idx]},priorities[idx],completions[idx],unitcosts[idx]};
+	}
+
+	std::string_view name( int idx ) const { return names[idx]; }
+	const std::vector<std::string_view>& nameColumn() const { return names; }
+	const std::vector<double>& costColumn() const { return unitcosts; }
+	const NameArena& nameArena() const { return arena; }
+	int priority( int idx ) const { return priorities[idx]; }
+	int completion( int idx ) const { return completions[idx]; }
+	double unitcost( int idx ) const { return unitcosts[idx]; }
+};
+
+//========= SortSpec ========================================
+// a validated sortPrefs string compiled into the fields to compare, most significant first.
+// Comparisons through it read no options and keep no state, so they may run on any thread
+
+struct SortKey {
+	enum FIELD { NAME, PRIORITY, COMPLETION, UNITCOST } field;
+	bool descending;
+};
+
+class SortSpec {
+	SortKey keys[4];
+	int count;
+ public:
+	SortSpec( const std::string &prefs="" ); // prefs must pass UserOptions::validateString()
+	int size() const { return count; }
+	const SortKey& operator []( int i ) const { return keys[i]; }
+};
+
+// negative, zero or positive as record a's field orders before, with or after record b's
+template <SortKey::FIELD F>
+inline int compareField( const GoalColumns &v, int a, int b ) {
+	if constexpr (F==SortKey::NAME)
+		return v.name(a).compare(v.name(b));
+	else if constexpr (F==SortKey::PRIORITY)
+		return int(v.priority(a))-int(v.priority(b));
+	else if constexpr (F==SortKey::COMPLETION)
+		return int(v.completion(a))-int(v.completion(b));
+	else
+		return (v.unitcost(a)>v.unitcost(b))-(v.unitcost(a)<v.unitcost(b));
+}
+
+inline int compareField( const GoalColumns &v, SortKey::FIELD field, int a, int b ) {
+	switch (field) {
+		case SortKey::NAME: return compareField<SortKey::NAME>(v,a,b);
+		case SortKey::PRIORITY: return compareField<SortKey::PRIORITY>(v,a,b);
+		case SortKey::COMPLETION: return compareField<SortKey::COMPLETION>(v,a,b);
+		default: return compareField<SortKey::UNITCOST>(v,a,b);
+	}
+}
+
+// orders by the keys of spec from the given one on, then by index, the file order
+inline bool lessFrom( const GoalColumns &v, const SortSpec &spec, int from, int a, int b ) {
+	for (int i=from;i<spec.size();i++)
+		if (int order=compareField(v,spec[i].field,a,b))
+			return spec[i].descending? order>0 : order<0;
+	return a<b;
+}
+
+// the leading key, which decides most comparisons, is compiled in
+template <SortKey::FIELD F, bool DESCENDING>
+struct KeyedLess {
+	const GoalColumns *v;
+	const SortSpec *spec;
+	bool operator()( int a, int b ) const {
+		if (int order=compareField<F>(*v,a,b))
+			return DESCENDING? order>0 : order<0;
+		return lessFrom(*v,*spec,1,a,b);
+	}
+};
+
+// calls f with the KeyedLess for spec's leading key. spec must not be empty
+template <class F>
+void withKeyedLess( const GoalColumns &v, const SortSpec &spec, F f ) {
+	switch (spec[0].field*2+spec[0].descending) {
+		case 0: f(KeyedLess<SortKey::NAME,false>{&v,&spec}); break;
+		case 1: f(KeyedLess<SortKey::NAME,true>{&v,&spec}); break;
+		case 2: f(KeyedLess<SortKey::PRIORITY,false>{&v,&spec}); break;
+		case 3: f(KeyedLess<SortKey::PRIORITY,true>{&v,&spec}); break;
+		case 4: f(KeyedLess<SortKey::COMPLETION,false>{&v,&spec}); break;
+		case 5: f(KeyedLess<SortKey::COMPLETION,true>{&v,&spec}); break;
+		case 6: f(KeyedLess<SortKey::UNITCOST,false>{&v,&spec}); break;
+		default: f(KeyedLess<SortKey::UNITCOST,true>{&v,&spec}); break;
+	}
+}
+
+//========= SortCache =======================================
+// orderings of the search results the view left, so switching back to a recent sort order only
+// moves a vector. Each is keyed by what it was built from, the sort preferences, the search
+// criteria and the version of the records, and is taken out again when it becomes the view.
+// Least recently left entries go first once the budget is exceeded
+
+class SortCache {
+ public:
+	struct Key {
+		std::string prefs;
+		SearchCriteria criteria;
+		uint64_t dataver;
+		bool operator ==( const Key &other ) const {
+			return dataver==other.dataver && prefs==other.prefs && criteria==other.criteria;
+		}
+	};
+ private:
+	struct Entry {
+		Key key;
+		std::vector<int> order;
+		size_t prefix;	// how much of order is sorted
+	};
+	std::list<Entry> entries; // most recently stored first
+	size_t used;		// bytes held by the orders
+ public:
+	SortCache():used{0} {}
+	void put( Key key, std::vector<int> &&order, size_t prefix, size_t budget );
+	bool take( const Key &key, std::vector<int> &order, size_t &prefix ); // false if not cached
+	void clear() { entries.clear(); used=0; }
+	size_t size() const { return entries.size(); }
+	size_t bytes() const { return used; }
+};
+
 //========= GoalContainer ===================================
 
 class GoalContainer {
 	bool modifiedGoals;
 	std::string filename;
-	std::vector<Goal> v;	// Unique storage of Goal records in raw order as read from file
-				// additions and modifications are stored in this vector
-
-	std::set<int> active;	// contains indices of v which are not deleted. Used as base for search
-	std::map<std::string,int> names; // goal labels must be unique, facilitating enforcement
-	std::set<int> searchRes; // active indices of v which are included in search results. Used as
+	GoalColumns v;		// Unique storage of Goal records in raw order as read from file
+				// additions and modifications are stored in these columns
+
+	DynamicBitset active;	// contains indices of v which are not deleted. Used as base for search
+	NameIndex names;	// goal labels must be unique, facilitating enforcement. keyed by v's name column
+	BucketIndex byPriority;	// live records by field value, answering the equality filters of a search
+	BucketIndex byCompletion;
+	CostIndex byCost;	// built on the first unitcost search
+	TrigramIndex byTrigram;	// narrows name searches, built on the first one
+	bool useTrigrams;
+	DynamicBitset searchRes; // active indices of v which are included in search results. Used as
 				 // base for 'sorted' initialisation. 
 
 	std::vector<int> sorted;// will contain the proper order of v's indices when sorted
+	size_t sortedPrefix;	// sorted[0,sortedPrefix) is in order, the rest follows it unordered
+	void ensureSorted( size_t count ); // orders sorted up to count, see sortGoals()
 	int sortver;
+	SortSpec sortSpec;	// UserOptions' sortPrefs, compiled for specver
+	int specver;
+	const SortSpec& currentSortSpec();
+	uint64_t dataver;	// bumped by every change to the records
+	SortCache sortCache;	// orderings of other sort preferences or searches, for dataver
+	SortCache::Key viewKey;	// what sorted was built from, its dataver stays behind on unplaced edits
+	void recordsChanged( bool viewPatched ); // drops stale orderings, see sortGoals()
 	int searchver;
-	bool refreshSort; //any modification will raise this flag to signify need to refresh ordering.
+	NameMatcher matcher;	// the name filter of the search criteria, compiled for matcherver
+	int matcherver;
+	const NameMatcher& currentMatcher();
+	bool matchFields( int gidx, const SearchCriteria &criteria, const NameMatcher &nameFilter ) const;
+	bool refreshSort; //bulk changes raise this flag to signify need to refresh ordering.
+	bool viewIsCurrent();		// single edits may update sorted in place
+	void placeSorted( int idx );	// binary search for idx's place in the ordered prefix
+	void unplaceSorted( int idx );
 	bool refreshSearch; // re-run search after an update to search criteria
+	bool mappedParsing; // load through the memory-mapped parser instead of the stream one
+	bool parallelLoading; // decode shards of large mapped files on the thread pool
+	size_t parallelLoadMin; // files smaller than this many bytes are always loaded serially
+
+	template <class Parser>
+	void loadGoals( Parser &parser ); // reads all goal records following the header
+	bool loadSharded( const MappedFile &file ); // parallel load, false if it must be done serially
+
+	bool useSnapshots; // keep a binary snapshot next to the xml file, see snapshot.cpp
+	static std::string snapshotName( const std::string &xmlName );
+	bool loadSnapshot();	// false when the snapshot is missing, stale or invalid
+	static bool saveSnapshot( const std::string &xmlName, const GoalColumns &records );
+
+	std::unique_ptr<Journal> journal; // write-ahead log of edits since the file was written, see journal.h
+	bool useJournal;
+	bool loading;		// edits made while loading or replaying are not journaled
+	std::string journalName() const;
+	void replayJournal();
+	void logEdit( const JournalEntry &entry );
+	void writeFile();	// rewrite the whole file in the background, folding the journal into it
+
+	std::unique_ptr<SaveWorker> saver; // declared after journal, so it finishes saving before journal goes
+	std::chrono::steady_clock::time_point lastSave; // for autosave()
+	static void writeRecords( const std::string &name, const GoalColumns &records, bool snapshot,
+			Journal *log, uint64_t folded ); // runs on the save worker
+	bool collectSave( bool block ); // reports failed background saves, false if there were any
+
+	double compactionRatio; // deleted records compact() tolerates, as a fraction of v
+	void compactIfNeeded();
+
+	void modifyGoal( int globalID, const Goal& newvals ); // index and name checks already done
+	void removeGoal( int globalID ); // from every structure but sorted
+	template <class Parser>
+	Goal decodeGoal( Parser &parser, std::string_view label ); // shared by both readGoal()s
  public:
-	GoalContainer():modifiedGoals{false},sortver{-1},searchver{-1},refreshSort{true},refreshSearch{true} {}
+	GoalContainer();
+	~GoalContainer();
 
-	void printRecord( std::ostream &strm, int id ) { v[sorted[id]].print(strm);}
-	int printAll( std::ostream &strm,int first=0,int maxToPrint=1000) const;
+	void printRecord( std::ostream &strm, int id ) { ensureSorted(id+1); v[sorted[id]].print(strm);}
+	int printAll( std::ostream &strm,int first=0,int maxToPrint=1000);
 
 	size_t size() { return v.size(); }
-	size_t activesize() { return active.size();}
-	size_t searchsize() { return searchRes.size();}
+	size_t activesize() { return active.count();}
+	size_t searchsize() { return searchRes.count();}
 
 	bool isModified() { return modifiedGoals; }
+	void setMappedParsing( bool newvalue ) { mappedParsing = newvalue; }
+	void setParallelLoading( bool newvalue ) { parallelLoading = newvalue; }
+	void setParallelLoadMin( size_t bytes ) { parallelLoadMin = bytes; }
+	void setSnapshots( bool newvalue ) { useSnapshots = newvalue; }
+	void setJournaling( bool newvalue ) { useJournal = newvalue; } // takes effect on the next loadFile
+	void setCompactionRatio( double ratio ) { compactionRatio = ratio; } // above 1 never compacts
+	void setTrigramIndex( bool newvalue ) { useTrigrams = newvalue; if (!newvalue) byTrigram.clear(); }
 
 	int loadFile( const std::string &name );
-	bool saveFile();
+	bool saveFile();	// cheap when the journal already holds the edits, see goals.cpp
+	void saveInBackground(); // same as saveFile(), without waiting for the disk
+	bool waitForSave();	// until background saves are done, false if one of them failed
+	void autosave();	// saveInBackground() once the options' autosave interval has passed
+	bool foldJournal();	// rewrite the file with all journaled edits and empty the journal
+	void discardChanges();	// the user chose not to save: drop this session's journaled edits
 
 	Goal readGoal(XMLParser &p, std::string &label);
-	void writeGoal( XMLWriter& writer, const Goal& goal); 
+	Goal readGoal(MappedXMLParser &p, std::string_view label);
+	static void writeGoal( XMLWriter& writer, const Goal& goal); 
+	static void writeGoal( XMLWriter& writer, const GoalColumns& records, int idx); 
 	void insertGoal( const Goal& newGoal);
 	bool modifyRecord( int recordID, const Goal& newvals ); 
 
 	int getGoalByRecordID(int recordID, Goal& copy); //returns index if found and stores values in copy
 	bool checkRecordID( int recordID );// confirm id in current displayed set.
 	bool deleteRecord( int recordID ); // remove from active goal record set.
+	void compact();	// drop deleted records from v, renumbering the rest. display order is kept
 
-	int findNameIndex( const std::string& name ) const;
+	int findNameIndex( std::string_view name ) const;
 
 	bool matchGoal( int idx );
-	bool matchGoal( int idx, const Goal& searchCriteria); // used for searching repeated records
+	bool matchGoal( int idx, const SearchCriteria& criteria); // used for searching repeated records
 
 	void sortGoals();
 	void searchGoals();
@@ -107,11 +382,15 @@ class GoalContainer {
 #endif //TESTING_ACTIVE
 };
 
+// orders record indices of a container as the current sortPrefs ask. A copy of the compiled
+// spec is kept, so the comparator is not affected by later changes of the options
+
 class GoalComparator {
-	GoalContainer *gc;
+	const GoalColumns *v;
+	SortSpec spec;
 public:
-	GoalComparator( GoalContainer* cont):gc{cont}{} 
-	bool operator()( const int& a, const int& b);
+	GoalComparator( GoalContainer* cont):v{&cont->v},spec{cont->currentSortSpec()} {} 
+	bool operator()( const int& a, const int& b) const { return lessFrom(*v,spec,0,a,b); }
 };
 
 //======== XMLParser =======================================
@@ -132,31 +411,98 @@ class XMLParser {
 
 };
 
+//======== MappedFile =======================================
+// read-only memory mapping of a whole file. an empty or missing file maps to an empty range
+
+class MappedFile {
+	const char* data;
+	size_t length;
+	bool opened;
+ public:
+	MappedFile( const std::string& name );
+	~MappedFile();
+
+	MappedFile( const MappedFile &a )		= delete;
+	MappedFile& operator=( const MappedFile &a )	= delete;
+
+	const char* begin() const { return data; }
+	const char* end() const { return data+length; }
+	size_t size() const { return length; }
+	bool good() const { return opened; }
+};
+
+//======== MappedXMLParser ==================================
+// zero-copy counterpart of XMLParser, walking a pointer over a mapped file or a part of it.
+// returned views point into the mapping and stay valid for the lifetime of the parser's file
+
+class MappedXMLParser {
+	std::unique_ptr<MappedFile> file;	// null when parsing a range owned by somebody else
+	const char* cur;
+	const char* last;
+	bool opened;
+ public:
+	MappedXMLParser( const std::string& name );
+	MappedXMLParser( const char* first, const char* end, bool good=true ):
+		cur{first},last{end},opened{good} {}
+
+	//read the XML header raw string
+	std::string_view getHeader();
+	//read the following label, thow on error
+	std::string_view getLabel();
+	//assuming reading pointer just after the starting label, read LEAF data up to next <.
+	std::string_view getLeafData();
+	bool moreToGo() const { return cur<last; }
+	void absorbComment();
+
+	const char* position() const { return cur; }
+	const char* end() const { return last; }
+};
+
 //======== XMLWriter ========================================
 
 class XMLWriter {
-	mutable std::ofstream out;
+	std::string filename;
+	std::string buf;	// the whole document, written out at once by flush()
 	int indentLevel;
 	std::vector<std::pair<std::string,bool>> labelStack; // keeps open label hierarchy 
 
 	//write leading tabs
-	bool indent() {
-		for (int i=0;i<indentLevel;i++)
-			out<<'\t';
-	}
+	void indent();
+	void appendNumber( int value );
  public:
-	XMLWriter( const std::string& name ):out{name},indentLevel{0} {
+	XMLWriter( const std::string& name ):filename{name},indentLevel{0} {
 		labelStack.clear();
 	} 
+	//expected document size, to avoid regrowing the buffer
+	void reserve( size_t bytes ) { buf.reserve(bytes); }
 	//write header string
 	void writeHeader();
 	//write openlabel, push label in label stack, increment indent level, optionally start new line
-	void openLabel(const std::string& label, bool newline=false);
+	void openLabel(std::string_view label, bool newline=false);
 	//write closelabel, pop label from label stack,reduce indent level, start a new line
 	void closeLabel();
 	//write a whole goal entry
-	void writeLeaf( const std::string &label, const std::string &data);
+	void writeLeaf( std::string_view label, std::string_view data);
+	void writeLeaf( std::string_view label, int data);
+	//fixed-point, same digits as printf's %.<decimals>f
+	void writeLeaf( std::string_view label, double data, int decimals);
+	//write the document with a single write(2) and atomically replace the file with it, see
+	//atomicReplace(). throws on failure. nothing reaches the file unless flush() is called
+	void flush( bool keepBackup=false, const std::function<void(int)> &beforeRename=nullptr );
 };
+
+//======== crash-safe file replacement =======================
+
+// writes data to a temporary file in the same directory, fsyncs it and rename()s it over name,
+// so readers see either the old or the new contents, never a torn file. throws on failure.
+// with keepBackup the previous contents remain as name.bak, see backupFile().
+// beforeRename is handed the descriptor of the synced temporary file just before it takes name's place
+void atomicReplace( const std::string &name, std::string_view data, bool keepBackup=false,
+		const std::function<void(int)> &beforeRename=nullptr );
+
+// makes name.bak hold the current contents of name, as a hard link when the filesystem allows
+// and a copy_file_range() copy otherwise. returns false if name does not exist or on error
+bool backupFile( const std::string &name );
 	
 
 //==============UserOptions Singleton==============================================
@@ -168,12 +514,18 @@ class UserOptions {
 	std::string sortPrefs;  // field-order pairs, in lowercase. used by comparator object
 	std::string filename;
 	int sortingver;// will increase to indicate a new sorting string set.
-	Goal searchCriteria;
+	SearchCriteria searchCriteria;
 	int searchver;
+	int autosave; // seconds between background saves of modified goals, 0 disables them
+	int threads; // size of the thread pool, 0 for one per core
+	int parallelSearchMin; // active records below which searches run on the calling thread only
+	int parallelSortMin; // results below which sorting runs on the calling thread only
+	int sortCacheMB; // memory kept for the orderings of recent sort preferences, 0 disables it
 	
 	//private constructor, singleton
 	UserOptions():verbosity{true},paging{false},showNumbers{false},sortPrefs{""},sortingver{0},
-	       		searchCriteria{"",-1,-1,-1.},searchver{0}	{} 
+	       		searchCriteria{},searchver{0},autosave{0},
+			threads{0},parallelSearchMin{1<<16},parallelSortMin{1<<17},sortCacheMB{64} {} 
 public:
 	static UserOptions& getInstance() { 
 		static UserOptions userOptions; // the first and only instance created.
@@ -194,18 +546,26 @@ public:
 	bool getVerbosity() {return verbosity;}
 	bool getPaging() { return paging; }
 	bool getShowNum() { return showNumbers; }
+	int getAutosave() { return autosave; }
+	int getThreads() { return threads; }
+	int getParallelSearchMin() { return parallelSearchMin; }
+	int getParallelSortMin() { return parallelSortMin; }
+	int getSortCacheMB() { return sortCacheMB; }
 
 	bool validateString( std::string candidatePrefs );
 	std::string getSortPrefs() const {return sortPrefs;}
-	Goal getSearchCriteria() const {return searchCriteria;}
+	const SearchCriteria& getSearchCriteria() const {return searchCriteria;}
 
 	void setVerbosity( bool newvalue ) { verbosity = newvalue; }
 	void setPaging( bool newvalue ) { paging = newvalue; }
 	void setShowNum( bool newvalue ) { showNumbers = newvalue; }
+	void setAutosave( int seconds ) { autosave = (seconds>0? seconds : 0); }
+	void setThreads( int count ) { threads = (count>0? count : 0); } // applied by StateMachine::run()
+	void setParallelSearchMin( int records ) { parallelSearchMin = (records>0? records : 0); }
+	void setParallelSortMin( int records ) { parallelSortMin = (records>0? records : 0); }
+	void setSortCacheMB( int megabytes ) { sortCacheMB = (megabytes>0? megabytes : 0); }
 	void setSortPrefs(std::string newPrefs);
-	void setSearchCriteria( Goal newCriteria);//copy is preferrable here. may alter invalid values
-	
-	friend class GoalComparator;// to avoid 3 function calls for every iteration of the comparator
+	void setSearchCriteria( SearchCriteria newCriteria);//copy is preferrable here. clamps the ranges
 };
 
 #endif
@@ -0,0 +1,104 @@
+// JOURNAL.H
+// append-only write-ahead journal of goal record edits, replayed on top of the goals file at startup
+// Copyright 2018 Thanasis Karpetis
+//
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef JOURNAL_H
+ #define JOURNAL_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <mutex>
+#include "goals.h"
+
+// identifies one version of a file. a journal only applies to the goals file it was started on,
+// so rewriting the goals file (a new inode through rename()) makes an old journal stale
+struct FileSignature {
+	uint64_t size;
+	int64_t mtimeSec;
+	int64_t mtimeNsec;
+	uint64_t inode;
+
+	static FileSignature of( const std::string &name ); // all zero for a missing file
+	static FileSignature of( int fd );
+	bool operator ==( const FileSignature &other ) const {
+		return size==other.size && mtimeSec==other.mtimeSec && mtimeNsec==other.mtimeNsec &&
+			inode==other.inode;
+	}
+};
+
+// one edit. records are identified by name, which is unique among live goals
+struct JournalEntry {
+	enum OP {
+		OP_INSERT=1,
+		OP_MODIFY,
+		OP_DELETE
+	} op;
+	std::string name;	// the record to modify or delete
+	Goal goal;		// new values for insert and modify
+
+	JournalEntry( OP o=OP_INSERT, const std::string &n="", const Goal &g=Goal() ):op{o},name{n},goal{g} {}
+};
+
+// Every entry is framed by its length and a checksum, so a record torn by a crash is recognised
+// and dropped together with anything after it.
+// A background save rewrites the journal from its own thread through rebase(), so every
+// public member locks it.
+class Journal {
+	std::mutex mtx;
+	std::string filename;
+	int fd;
+	FileSignature base;	// the goals file the entries apply to
+	uint64_t entriesStart;	// offset of the first entry not yet folded into base
+	uint64_t length;	// bytes of valid journal
+	uint64_t shift;		// added to offsets to keep position() steady across rebase()
+	uint64_t sessionStart;	// length when the journal was opened, discardSession() returns to it
+	size_t count;		// entries from entriesStart on
+	size_t sessionCount;	// of those, entries up to sessionStart
+
+	void create();		// start a new journal file containing only the header
+	void closeFile();
+ public:
+	Journal():fd{-1},base{},entriesStart{0},length{0},shift{0},sessionStart{0},count{0},sessionCount{0} {}
+	~Journal() { close(); }
+
+	Journal( const Journal &a )		= delete;
+	Journal& operator=( const Journal &a )	= delete;
+
+	// reads the journal of the given goals file. entries of a stale or foreign journal are not returned,
+	// that journal is renamed to name.stale with a warning. The file itself is only created by the
+	// first append()
+	std::vector<JournalEntry> open( const std::string &name, const FileSignature &baseFile );
+	void close();
+
+	// write the entry and sync it to disk before returning. throws on failure
+	void append( const JournalEntry &entry );
+	// forget the entries appended since open() or the last markSaved()
+	void discardSession();
+	// the user saved: entries so far are no longer discarded by discardSession()
+	void markSaved();
+	// the goals file was rewritten with every entry folded in. the journal restarts empty
+	void reset( const FileSignature &baseFile );
+	// an empty journal for a goals file about to be written under a new name, replacing any left there
+	void start( const std::string &name );
+
+	// the goals file is about to be replaced by one with the entries up to position() folded in,
+	// whose signature is next. The journal is rewritten to apply to either file, all of it to the
+	// current one and the entries past folded to its replacement, so a crash on either side of the
+	// rename loses nothing. throws on failure
+	void rebase( const FileSignature &next, uint64_t folded );
+	// the replacement took place: drop the journal if it holds nothing past the folded entries
+	void dropFolded();
+
+	// a point in the sequence of entries, unaffected by rebase()
+	uint64_t position();
+	size_t entries();
+	size_t unsaved(); // appended since open() or markSaved()
+	std::string name();
+	bool isOpen();
+};
+
+#endif
@@ -0,0 +1,64 @@
+// MATCHER.H
+// the name filter of the search criteria, compiled once and reused for every record
+// Copyright 2018 Thanasis Karpetis
+//
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MATCHER_H
+ #define MATCHER_H
+
+#include <string>
+#include <string_view>
+#include <regex>
+#include "scanner.h"
+
+// Most filters typed at the prompt are plain words. Those, optionally anchored with ^ and $
+// and with punctuation escaped by a backslash, are matched as literals with the vectorized
+// substring scan or a compare. Only patterns using other regex syntax reach std::regex,
+// and then only for the names that contain the literal every match has to start with.
+// A pattern std::regex rejects is searched for literally.
+
+class NameMatcher {
+	enum KIND {
+		MATCH_ALL,	// empty pattern
+		MATCH_LITERAL,	// anywhere in the name
+		MATCH_PREFIX,	// ^literal
+		MATCH_SUFFIX,	// literal$
+		MATCH_EXACT,	// ^literal$
+		MATCH_REGEX
+	} kind;
+	std::string source;
+	std::string literal;	// for MATCH_REGEX, a substring of every match, possibly empty
+	std::regex re;
+
+	bool matchRegex( std::string_view name ) const;
+ public:
+	NameMatcher( const std::string &pattern="" );
+
+	const std::string& pattern() const { return source; }
+	bool isRegex() const { return kind==MATCH_REGEX; }
+	// a substring of every name the filter matches, possibly empty
+	const std::string& required() const { return literal; }
+
+	bool matches( std::string_view name ) const {
+		switch (kind) {
+			case MATCH_ALL:
+				return true;
+			case MATCH_LITERAL:
+				return scanSubstring(name.data(),name.data()+name.size(),
+						literal.data(),literal.size())!=name.data()+name.size();
+			case MATCH_PREFIX:
+				return name.compare(0,literal.size(),literal)==0;
+			case MATCH_SUFFIX:
+				return name.size()>=literal.size() &&
+					name.compare(name.size()-literal.size(),literal.size(),literal)==0;
+			case MATCH_EXACT:
+				return name==literal;
+			default:
+				return matchRegex(name);
+		}
+	}
+};
+
+#endif
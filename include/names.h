@@ -0,0 +1,121 @@
+// NAMES.H
+// storage and lookup of goal names: a string arena, an open-addressing hash index into it and
+// a trigram index narrowing substring searches
+// Copyright 2018 Thanasis Karpetis
+//
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef NAMES_H
+ #define NAMES_H
+
+#include <vector>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <cstdint>
+
+//======== NameArena ========================================
+// append-only storage for names. views returned by add() stay valid until clear(), since blocks
+// are never moved. Replaced names are not reclaimed, wasted() tells how much is left behind
+
+class NameArena {
+	std::vector<std::unique_ptr<char[]>> blocks;
+	char* cur;		// free space of the last block
+	size_t left;
+	size_t total;		// bytes handed out
+	size_t dropped;		// of those, bytes released through drop()
+ public:
+	static const size_t blockSize=1<<16;
+
+	NameArena():cur{nullptr},left{0},total{0},dropped{0} {}
+	NameArena( const NameArena &a )			= delete;
+	NameArena& operator=( const NameArena &a )	= delete;
+	NameArena( NameArena &&a )			= default; // blocks, and views into them, survive moves
+	NameArena& operator=( NameArena &&a )		= default;
+
+	std::string_view add( std::string_view name );
+	void drop( std::string_view name ) { dropped+=name.size(); } // name is no longer referenced
+	void clear();
+
+	size_t used() const { return total; }
+	size_t wasted() const { return dropped; }
+};
+
+//======== NameIndex ========================================
+// maps a name to the index of its record. slots hold the record index and part of the hash only,
+// the name itself is read from the record columns when a probe needs to compare it, so every name
+// is stored once. Linear probing with backward-shift deletion, no tombstones.
+
+class NameIndex {
+	struct Slot {
+		uint32_t hash;
+		int idx;	// -1 when empty
+	};
+	std::vector<Slot> slots;	// power of two, at most 3/4 full
+	size_t used;
+	const std::vector<std::string_view> &keys;	// the names column, keys[idx] is idx's name
+
+	static uint32_t hashOf( std::string_view name );
+	size_t mask() const { return slots.size()-1; }
+	size_t locate( std::string_view name, uint32_t hash ) const; // slot of name or the empty slot ending its probe
+	void grow();
+ public:
+	NameIndex( const std::vector<std::string_view> &names ):used{0},keys{names} { clear(); }
+
+	// index of the record with this name, -1 if none
+	int find( std::string_view name ) const;
+	// false, changing nothing, if the name is present. keys[idx] must hold name before the next call
+	bool insert( std::string_view name, int idx );
+	void erase( std::string_view name );
+	// records were renumbered, record i is now newIndex[i]. every indexed record must survive
+	void remap( const std::vector<int> &newIndex );
+	void clear();
+	void reserve( size_t n );
+	size_t size() const { return used; }
+};
+
+//======== TrigramIndex =====================================
+// one posting list per three-byte sequence, holding the live records whose name contains it in
+// increasing order. A name containing a literal contains every trigram of the literal, so the
+// intersection of their lists is a superset of the matches, which the name filter verifies.
+// Like CostIndex it is built on first use and kept current by edits from then on
+
+class TrigramIndex {
+	std::unordered_map<uint32_t,std::vector<int>> postings;
+	bool built;
+	const std::vector<std::string_view> &keys;	// the names column
+	std::vector<uint32_t> grams;			// scratch, the distinct trigrams of one name
+
+	void collect( std::string_view name );		// fills grams
+	void build( const std::vector<int> &live );
+	bool intersect( std::string_view literal, std::vector<int> &out );
+ public:
+	static const size_t gramSize=3;
+
+	TrigramIndex( const std::vector<std::string_view> &names ):built{false},keys{names} {}
+
+	// call remove() before the record's name changes or it is deleted, and add() once it is set
+	void add( int idx );
+	void remove( int idx );
+	// the live records whose name may contain literal, in increasing order. false, leaving out
+	// alone, when literal is too short to narrow the search. forEachLive(f) calls f for every
+	// live record, used to build the index on first use
+	template <class Members>
+	bool candidates( std::string_view literal, std::vector<int> &out, Members forEachLive ) {
+		if (literal.size()<gramSize)
+			return false;
+		if (!built) {
+			std::vector<int> live;
+			forEachLive([&]( int idx ) { live.push_back(idx); });
+			build(live);
+		}
+		return intersect(literal,out);
+	}
+	// records were renumbered in order, see GoalContainer::compact(). -1 marks a dropped record
+	void remap( const std::vector<int> &newIndex );
+	void clear() { postings.clear(); built=false; }
+	bool isBuilt() const { return built; }
+};
+
+#endif
@@ -0,0 +1,88 @@
+// PARALLELSORT.H
+// sorting large index sequences on the thread pool
+// Copyright 2018 Thanasis Karpetis
+//
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PARALLELSORT_H
+ #define PARALLELSORT_H
+
+#include <vector>
+#include <algorithm>
+#include "threadpool.h"
+
+namespace parallel_detail {
+
+// how many of the k smallest elements of the merge of a[0,na) and b[0,nb) come from a,
+// a's elements going first among equals, as std::merge places them
+template <class Less>
+size_t corank( size_t k, const int *a, size_t na, const int *b, size_t nb, Less &less ) {
+	size_t lo= k>nb? k-nb : 0;
+	size_t hi= std::min(k,na);
+	while (lo<hi) {
+		size_t i=lo+(hi-lo)/2;
+		if (!less(b[k-i-1],a[i]))	// a[i] is not after b[k-i-1], it belongs in the prefix
+			lo=i+1;
+		else
+			hi=i;
+	}
+	return lo;
+}
+
+} // namespace parallel_detail
+
+// Sorts order by less, leaving it exactly as sortRun(order.data(),order.data()+order.size())
+// would when less is a strict total order, as the index tie-break of lessFrom makes it.
+// Each thread sorts a run of its own with sortRun, then the runs are merged pairwise. Every
+// merge is cut at co-ranks into pieces of equal output, so the last merges, of few long runs,
+// still keep all threads busy.
+template <class SortRun, class Less>
+void parallelSort( std::vector<int> &order, SortRun sortRun, Less less, ThreadPool &pool ) {
+	size_t n=order.size();
+	size_t threads=pool.size();
+	std::vector<size_t> bounds(threads+1);	// run r is [bounds[r],bounds[r+1])
+	for (size_t r=0;r<=threads;r++)
+		bounds[r]=n*r/threads;
+	pool.run(threads,[&]( size_t r ) {
+		sortRun(order.data()+bounds[r],order.data()+bounds[r+1]);
+	});
+
+	std::vector<int> buffer(n);
+	int *from=order.data();
+	int *to=buffer.data();
+	while (bounds.size()>2) {
+		size_t runs=bounds.size()-1;
+		size_t pairs=runs/2;
+		size_t pieces=std::max<size_t>(1,threads/pairs);
+		size_t tasks=pairs*pieces+runs%2;	// an odd run out is copied by a task of its own
+		pool.run(tasks,[&]( size_t t ) {
+			size_t p=t/pieces;
+			if (p==pairs) {
+				std::copy(from+bounds[runs-1],from+n,to+bounds[runs-1]);
+				return;
+			}
+			size_t start=bounds[2*p];
+			const int *a=from+start;
+			const int *b=from+bounds[2*p+1];
+			size_t na=bounds[2*p+1]-start;
+			size_t nb=bounds[2*p+2]-bounds[2*p+1];
+			size_t piece=t%pieces;
+			size_t k0=(na+nb)*piece/pieces;
+			size_t k1=(na+nb)*(piece+1)/pieces;
+			size_t i0=parallel_detail::corank(k0,a,na,b,nb,less);
+			size_t i1=parallel_detail::corank(k1,a,na,b,nb,less);
+			std::merge(a+i0,a+i1,b+(k0-i0),b+(k1-i1),to+start+k0,less);
+		});
+		std::vector<size_t> merged;
+		for (size_t r=0;r<runs;r+=2)
+			merged.push_back(bounds[r]);
+		merged.push_back(n);
+		bounds.swap(merged);
+		std::swap(from,to);
+	}
+	if (from!=order.data())
+		order.swap(buffer);
+}
+
+#endif
@@ -0,0 +1,22 @@
+// RADIXSORT.H
+// non-comparison sorting of record indices by the numeric keys of a sort spec
+// Copyright 2018 Thanasis Karpetis
+//
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RADIXSORT_H
+ #define RADIXSORT_H
+
+#include "goals.h"
+
+// Sorts [first,last), record indices in any order, as lessFrom(records,spec,0,...) would.
+// The numeric keys spec starts with are packed into one order-preserving key of at most 80 bits:
+// priority and completion a byte each, unitcost as a double whose bits compare like integers,
+// descending keys inverted. An LSD radix sort by that key skips the bytes every record shares.
+// Runs of equal packed keys are finished by comparison, from the first name key on or by index.
+// Returns false, leaving the range alone, when spec starts with the name or there are too few
+// records to be worth it.
+bool radixSort( int *first, int *last, const GoalColumns &records, const SortSpec &spec );
+
+#endif
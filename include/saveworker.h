@@ -0,0 +1,48 @@
+// SAVEWORKER.H
+// background thread writing the goal records to disk while the state machine keeps running
+// Copyright 2018 Thanasis Karpetis
+//
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef SAVEWORKER_H
+ #define SAVEWORKER_H
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// runs save tasks one at a time on its own thread, started by the first submit().
+// A task still waiting when a newer one is submitted is dropped: the newer task saves a later
+// copy of the same records. The destructor finishes the queued work before joining.
+
+class SaveWorker {
+	std::thread worker;
+	std::mutex mtx;
+	std::condition_variable wake;		// the worker waits here for a task
+	std::condition_variable idle;		// wait() waits here for the worker to run out of tasks
+	std::function<void()> pending;		// the next task, empty if none
+	bool running;				// a task is being executed
+	bool stopping;
+	std::string failures;			// messages of failed tasks since the last wait() or errors()
+
+	void workerLoop();
+ public:
+	SaveWorker():running{false},stopping{false} {}
+	~SaveWorker();
+
+	SaveWorker( const SaveWorker &a )		= delete;
+	SaveWorker& operator=( const SaveWorker &a )	= delete;
+
+	// queue a task. an exception it throws is reported by wait() or errors()
+	void submit( std::function<void()> task );
+	// block until every submitted task has run. returns their error messages, empty if all succeeded
+	std::string wait();
+	// the error messages so far, without waiting
+	std::string errors();
+	bool busy();
+};
+
+#endif
@@ -0,0 +1,35 @@
+// SCANNER.H
+// vectorized delimiter scanning for the memory-mapped xml parser and the name filter
+// SSE2 is the baseline on x86-64, an AVX2 path is picked at runtime when the cpu offers it
+// Copyright 2018 Thanasis Karpetis
+//
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef SCANNER_H
+ #define SCANNER_H
+
+#include <cstddef>
+
+enum ScanLevel {
+	SCAN_SCALAR=0,
+	SCAN_SSE2,
+	SCAN_AVX2
+};
+
+// first byte in [p,end) equal to any of the first n (1 to 5) bytes of set, or end if none
+const char* scanAny( const char* p, const char* end, const char* set, int n );
+
+// first position of the digraph ab in [p,end), or end if none
+const char* scanDigraph( const char* p, const char* end, char a, char b );
+
+// first position of the n bytes of needle in [p,end), or end if none. p if n is 0
+const char* scanSubstring( const char* p, const char* end, const char* needle, size_t n );
+
+// the widest level the running cpu supports
+ScanLevel bestScanLevel();
+ScanLevel getScanLevel();
+// select an implementation, clamped to what the cpu supports. used by tests and benchmarks
+ScanLevel setScanLevel( ScanLevel level );
+
+#endif
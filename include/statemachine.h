@@ -130,6 +130,7 @@ class DeleteState: public State {
 //the editor class
 struct ModGoal {
         Goal goal;
+	SearchCriteria criteria;	// edited instead of goal in MODE_SEARCH
 	enum MODE_USE {
 		MODE_INSERT,
 		MODE_EDIT,
@@ -187,7 +188,7 @@ class SearchState: public GoalEditingState {
 	
 public:
 	SearchState():GoalEditingState{STATE_SEARCH},state{STATE_INPUT} {
-		modGoal.goal = UserOptions::getInstance().getSearchCriteria();
+		modGoal.criteria = UserOptions::getInstance().getSearchCriteria();
 		modGoal.mode = ModGoal::MODE_SEARCH;
 	}
 
@@ -215,6 +216,8 @@ class EditorState: public State {
 	int getPriority();
 	int getCompletion();
 	double getUnitCost();
+	template <class T>
+	void getRange( const char* field, T &lo, T &hi, T min, T max ); // a search filter
  public:
         EditorState():State{STATE_EDITOR},editState{EDITOR_INTRO}{}
 	void setPrevState( State* prev); 
@@ -0,0 +1,65 @@
+// THREADPOOL.H
+// fixed-size worker pool shared by the parallel parts of the Goals application
+// Copyright 2018 Thanasis Karpetis
+//
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef THREADPOOL_H
+ #define THREADPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+
+//==============ThreadPool Singleton==============================================
+// runs batches of independent tasks. the calling thread takes part in the batch,
+// tasks are handed out one at a time so uneven tasks balance themselves.
+// Note: run() must not be called from inside a task.
+
+class ThreadPool {
+	std::vector<std::thread> workers;
+	std::mutex mtx;
+	std::condition_variable wake;		// workers wait here for a new batch
+	std::condition_variable finished;	// run() waits here for the batch to drain
+
+	const std::function<void(size_t)> *job;	// the current batch, valid while run() is active
+	size_t taskCount;
+	std::atomic<size_t> nextTask;
+	std::atomic<size_t> remaining;
+	int busy;				// workers currently draining a batch
+	unsigned generation;			// bumped for every batch
+	bool stopping;
+	std::exception_ptr error;		// first exception thrown by a task
+
+	void workerLoop();
+	void drain();				// execute tasks of the current batch until none is left
+	void stop();
+
+	ThreadPool():job{nullptr},taskCount{0},nextTask{0},remaining{0},busy{0},generation{0},stopping{false} {
+		resize(0);
+	}
+ public:
+	static ThreadPool& getInstance() {
+		static ThreadPool pool;
+		return pool;
+	}
+	~ThreadPool() { stop(); }
+
+	ThreadPool( ThreadPool &a)		= delete;
+	ThreadPool& operator=( ThreadPool &a)	= delete;
+
+	// total threads working on a batch, the caller included. 0 picks the hardware concurrency
+	void resize( unsigned threads );
+	unsigned size() const { return workers.size()+1; }
+
+	// calls fn(0)...fn(tasks-1) concurrently and returns when all are done.
+	// rethrows the first exception a task raised
+	void run( size_t tasks, const std::function<void(size_t)> &fn );
+};
+
+#endif
@@ -0,0 +1,370 @@
+// JOURNAL.CPP
+// write-ahead journal of goal record edits
+// Copyright 2018 Thanasis Karpetis
+//
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cstring>
+#include <cerrno>
+#include <iostream>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "journal.h"
+
+// Layout, in host byte order:
+//	header		magic, version, signature of the goals file the entries apply to, and while a
+//			save replaces that file the signature of the one it replaces with the offset
+//			where the entries not yet folded into the new file begin
+//	entries		uint32_t payload length, uint32_t checksum of the payload, payload
+//	payload		uint8_t op, name (uint32_t length and bytes), for insert and modify the goal:
+//			name, int32_t priority, int32_t completion, double unitcost
+
+namespace {
+
+const char journalMagic[8]={'G','O','A','L','J','R','N','L'};
+const uint32_t journalVersion=2;
+
+struct JournalHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+	FileSignature base;
+	FileSignature prior;	// the file base replaced, all zero if none. every entry applies to it
+	uint64_t priorEnd;	// entries before this offset are already folded into base
+};
+
+JournalHeader makeHeader( const FileSignature &base ) {
+	JournalHeader header;
+	memset(&header,0,sizeof(header));
+	memcpy(header.magic,journalMagic,sizeof(header.magic));
+	header.version=journalVersion;
+	header.base=base;
+	header.priorEnd=sizeof(header);
+	return header;
+}
+
+// FNV-1a, enough to tell a torn or garbled entry from a complete one
+uint32_t checksum( const char* p, size_t n ) {
+	uint32_t h=2166136261u;
+	for (size_t i=0;i<n;i++) {
+		h^=static_cast<unsigned char>(p[i]);
+		h*=16777619u;
+	}
+	return h;
+}
+
+template <class T>
+void put( std::string &buf, const T &value ) {
+	buf.append(reinterpret_cast<const char*>(&value),sizeof(T));
+}
+
+void putString( std::string &buf, const std::string &s ) {
+	put(buf,uint32_t(s.size()));
+	buf+=s;
+}
+
+// bounds-checked reading of a payload, any overrun marks the entry as corrupt
+struct Reader {
+	const char* p;
+	const char* end;
+	bool ok;
+
+	template <class T>
+	T get() {
+		T value{};
+		if (end-p<(ptrdiff_t)sizeof(T))
+			ok=false;
+		else {
+			memcpy(&value,p,sizeof(T));
+			p+=sizeof(T);
+		}
+		return value;
+	}
+	std::string getString() {
+		uint32_t n=get<uint32_t>();
+		if (!ok || end-p<(ptrdiff_t)n) {
+			ok=false;
+			return "";
+		}
+		std::string s(p,n);
+		p+=n;
+		return s;
+	}
+};
+
+std::runtime_error journalError( const std::string &what, const std::string &name ) {
+	return std::runtime_error(what+" "+name+": "+strerror(errno));
+}
+
+// a journal that does not match the goals file is renamed out of the way, never deleted: it may be
+// the only copy of edits saveFile() reported as saved, with the goals file restored or copied since
+void setAside( const std::string &name ) {
+	std::string aside=name+".stale";
+	struct stat st;
+	for (int i=1; stat(aside.c_str(),&st)==0; i++)
+		aside=name+".stale"+std::to_string(i);
+	if (rename(name.c_str(),aside.c_str())==0)
+		std::cerr<<name<<" was written for another version of its goals file, its edits were not "
+			"applied. kept as "<<aside<<'\n';
+	else
+		std::cerr<<name<<" was written for another version of its goals file and cannot be "
+			"renamed: "<<strerror(errno)<<'\n';
+}
+
+FileSignature signatureOf( const struct stat &st ) {
+	FileSignature sig{};
+	sig.size=st.st_size;
+	sig.mtimeSec=st.st_mtim.tv_sec;
+	sig.mtimeNsec=st.st_mtim.tv_nsec;
+	sig.inode=st.st_ino;
+	return sig;
+}
+
+} // namespace
+
+FileSignature FileSignature::of( const std::string &name ) {
+	struct stat st;
+	if (stat(name.c_str(),&st)!=0)
+		return FileSignature{};
+	return signatureOf(st);
+}
+
+// rename() keeps all of these, so a temporary file's signature is the one it has once renamed
+FileSignature FileSignature::of( int fd ) {
+	struct stat st;
+	if (fstat(fd,&st)!=0)
+		return FileSignature{};
+	return signatureOf(st);
+}
+
+std::vector<JournalEntry> Journal::open( const std::string &name, const FileSignature &baseFile ) {
+	std::lock_guard<std::mutex> lock{mtx};
+	closeFile();
+	filename=name;
+	base=baseFile;
+	std::vector<JournalEntry> entries;
+
+	fd=::open(name.c_str(),O_RDWR);
+	if (fd<0)
+		return entries;	// no journal yet, append() creates it
+
+	MappedFile file{name};
+	JournalHeader header;
+	bool valid= file.size()>=sizeof(header);
+	if (valid) {
+		memcpy(&header,file.begin(),sizeof(header));
+		valid= memcmp(header.magic,journalMagic,sizeof(header.magic))==0 &&
+			header.version==journalVersion;
+	}
+	bool current= valid && header.base==base;
+	// a save was interrupted before its file replaced this one: every entry still applies
+	bool interrupted= valid && !current && header.prior.inode!=0 && header.prior==base;
+	if (!current && !interrupted) {
+		// written against another version of the goals file. Saves fold the journal before they
+		// replace the file, so this one was copied, restored or moved with it
+		closeFile();
+		setAside(name);
+		return entries;
+	}
+	uint64_t start= current? header.priorEnd : sizeof(header);
+	const char* p=file.begin()+sizeof(header);
+	while (file.end()-p>=8) {
+		uint32_t len, sum;
+		memcpy(&len,p,4);
+		memcpy(&sum,p+4,4);
+		if ((uint64_t)(file.end()-p-8)<len || checksum(p+8,len)!=sum)
+			break;	// torn by a crash, this and anything after it is dropped
+		Reader in{p+8,p+8+len,true};
+		JournalEntry entry;
+		entry.op=static_cast<JournalEntry::OP>(in.get<uint8_t>());
+		entry.name=in.getString();
+		if (entry.op!=JournalEntry::OP_DELETE) {
+			entry.goal.name=in.getString();
+			entry.goal.priority=in.get<int32_t>();
+			entry.goal.completion=in.get<int32_t>();
+			entry.goal.unitcost=in.get<double>();
+		}
+		if (!in.ok || entry.op<JournalEntry::OP_INSERT || entry.op>JournalEntry::OP_DELETE)
+			break;
+		if (uint64_t(p-file.begin())>=start)
+			entries.push_back(entry);
+		p+=8+len;
+	}
+	length=p-file.begin();
+	if (length<file.size())
+		ftruncate(fd,length);	// later appends continue after the last good entry
+	entriesStart=std::min<uint64_t>(start,length);
+	if (interrupted) {
+		header=makeHeader(base);
+		if (pwrite(fd,&header,sizeof(header),0)==(ssize_t)sizeof(header))
+			fsync(fd);
+	}
+	shift=0;
+	sessionStart=length;
+	count=sessionCount=entries.size();
+	return entries;
+}
+
+// position() keeps growing, a save still queued must not fold entries appended after this
+void Journal::closeFile() {
+	if (fd>=0)
+		::close(fd);
+	fd=-1;
+	shift+=length;
+	entriesStart=length=sessionStart=0;
+	count=sessionCount=0;
+}
+
+void Journal::close() {
+	std::lock_guard<std::mutex> lock{mtx};
+	closeFile();
+	filename.clear();
+}
+
+void Journal::create() {
+	fd=::open(filename.c_str(),O_RDWR|O_CREAT|O_TRUNC,0644);
+	if (fd<0)
+		throw journalError("cannot create journal",filename);
+	JournalHeader header=makeHeader(base);
+	if (pwrite(fd,&header,sizeof(header),0)!=(ssize_t)sizeof(header) || fsync(fd)!=0)
+		throw journalError("cannot write journal",filename);
+	entriesStart=length=sizeof(header);
+	count=0;
+}
+
+void Journal::append( const JournalEntry &entry ) {
+	std::lock_guard<std::mutex> lock{mtx};
+	if (fd<0)
+		create();
+	std::string frame(8,'\0');	// length and checksum are filled in below
+	put(frame,uint8_t(entry.op));
+	putString(frame,entry.name);
+	if (entry.op!=JournalEntry::OP_DELETE) {
+		putString(frame,entry.goal.name);
+		put(frame,int32_t(entry.goal.priority));
+		put(frame,int32_t(entry.goal.completion));
+		put(frame,entry.goal.unitcost);
+	}
+	uint32_t len=frame.size()-8;
+	uint32_t sum=checksum(frame.data()+8,len);
+	memcpy(&frame[0],&len,4);
+	memcpy(&frame[4],&sum,4);
+	if (pwrite(fd,frame.data(),frame.size(),length)!=(ssize_t)frame.size() || fdatasync(fd)!=0)
+		throw journalError("cannot append to journal",filename);
+	length+=frame.size();
+	count++;
+}
+
+void Journal::discardSession() {
+	std::lock_guard<std::mutex> lock{mtx};
+	if (fd<0)
+		return;
+	if (sessionStart<sizeof(JournalHeader)) {	// created during this session
+		closeFile();
+		unlink(filename.c_str());
+		return;
+	}
+	ftruncate(fd,sessionStart);
+	fdatasync(fd);
+	length=sessionStart;
+	count=sessionCount;
+}
+
+void Journal::markSaved() {
+	std::lock_guard<std::mutex> lock{mtx};
+	sessionStart=length;
+	sessionCount=count;
+}
+
+void Journal::reset( const FileSignature &baseFile ) {
+	std::lock_guard<std::mutex> lock{mtx};
+	if (fd>=0) {
+		closeFile();
+		unlink(filename.c_str());
+	}
+	base=baseFile;
+}
+
+void Journal::start( const std::string &name ) {
+	std::lock_guard<std::mutex> lock{mtx};
+	closeFile();
+	filename=name;
+	base=FileSignature{};
+	unlink(name.c_str());
+}
+
+void Journal::rebase( const FileSignature &next, uint64_t folded ) {
+	std::lock_guard<std::mutex> lock{mtx};
+	if (fd<0) {
+		base=next;	// nothing journaled, the first append() starts on the new file
+		return;
+	}
+	std::string tail(length-entriesStart,'\0');
+	if (pread(fd,&tail[0],tail.size(),entriesStart)!=(ssize_t)tail.size())
+		throw journalError("cannot read journal",filename);
+	uint64_t cut=0;		// bytes of tail folded into the new file
+	size_t foldedEntries=0;
+	if (folded>shift+entriesStart)
+		cut=std::min<uint64_t>(folded-shift-entriesStart,tail.size());
+	for (uint64_t at=0; at<cut; foldedEntries++) {
+		uint32_t len;
+		memcpy(&len,&tail[at],4);
+		at+=8+len;
+	}
+	JournalHeader header=makeHeader(next);
+	header.prior=base;
+	header.priorEnd=sizeof(header)+cut;
+	std::string buf(reinterpret_cast<const char*>(&header),sizeof(header));
+	buf+=tail;
+	atomicReplace(filename,buf);
+	int replaced=::open(filename.c_str(),O_RDWR);
+	if (replaced<0)
+		throw journalError("cannot reopen journal",filename);
+	::close(fd);
+	fd=replaced;
+
+	// entries before entriesStart were dropped, offsets move back by that much
+	shift+=entriesStart-sizeof(header);
+	sessionStart=std::max<uint64_t>(sessionStart,entriesStart)-entriesStart+sizeof(header);
+	length=buf.size();
+	entriesStart=header.priorEnd;
+	count-=foldedEntries;
+	sessionCount-=std::min(sessionCount,foldedEntries);
+	base=next;
+}
+
+void Journal::dropFolded() {
+	std::lock_guard<std::mutex> lock{mtx};
+	if (fd>=0 && length==entriesStart) {
+		closeFile();
+		unlink(filename.c_str());
+	}
+}
+
+uint64_t Journal::position() {
+	std::lock_guard<std::mutex> lock{mtx};
+	return length+shift;
+}
+
+size_t Journal::entries() {
+	std::lock_guard<std::mutex> lock{mtx};
+	return count;
+}
+
+size_t Journal::unsaved() {
+	std::lock_guard<std::mutex> lock{mtx};
+	return count-sessionCount;
+}
+
+std::string Journal::name() {
+	std::lock_guard<std::mutex> lock{mtx};
+	return filename;
+}
+
+bool Journal::isOpen() {
+	std::lock_guard<std::mutex> lock{mtx};
+	return !filename.empty();
+}
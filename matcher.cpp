@@ -0,0 +1,108 @@
+// MATCHER.CPP
+// compiling a name filter into a literal search or a regex
+// Copyright 2018 Thanasis Karpetis
+//
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cstring>
+#include <cctype>
+#include "matcher.h"
+
+namespace {
+
+bool isMeta( char c ) {
+	return c && strchr("^$\\.*+?()[]{}|",c);
+}
+
+// \ followed by punctuation stands for that character, before a letter or digit it is a class
+// or an assertion
+bool isEscapedChar( std::string_view pattern, size_t i ) {
+	return i+1<pattern.size() && ispunct(static_cast<unsigned char>(pattern[i+1]));
+}
+
+// the literal pattern stands for, false if it uses any other regex syntax
+bool unescape( std::string_view pattern, std::string &literal ) {
+	literal.clear();
+	for (size_t i=0;i<pattern.size();i++) {
+		if (pattern[i]=='\\') {
+			if (!isEscapedChar(pattern,i))
+				return false;
+			literal+=pattern[++i];
+		}
+		else if (isMeta(pattern[i]))
+			return false;
+		else
+			literal+=pattern[i];
+	}
+	return true;
+}
+
+// the literal run a regex starts with, which every match contains. A character made optional
+// by the quantifier after it ends the run, an alternation anywhere leaves nothing
+std::string leadingLiteral( std::string_view pattern ) {
+	std::string literal;
+	if (pattern.find('|')!=std::string_view::npos)
+		return literal;
+	size_t i= (!pattern.empty() && pattern[0]=='^')? 1 : 0;
+	while (i<pattern.size()) {
+		char c=pattern[i];
+		size_t len=1;
+		if (c=='\\') {
+			if (!isEscapedChar(pattern,i))
+				break;
+			c=pattern[i+1];
+			len=2;
+		}
+		else if (isMeta(c))
+			break;
+		if (i+len<pattern.size() && strchr("*?{",pattern[i+len]))
+			break;
+		literal+=c;
+		i+=len;
+	}
+	return literal;
+}
+
+} // namespace
+
+NameMatcher::NameMatcher( const std::string &pattern ):kind{MATCH_ALL},source{pattern} {
+	if (pattern.empty())
+		return;
+	std::string_view body{pattern};
+	bool anchorStart= body.front()=='^';
+	if (anchorStart)
+		body.remove_prefix(1);
+	// a trailing $ anchors unless it is escaped
+	size_t escapes=0;
+	while (escapes+1<body.size() && body[body.size()-2-escapes]=='\\')
+		escapes++;
+	bool anchorEnd= !body.empty() && body.back()=='$' && escapes%2==0;
+	if (anchorEnd)
+		body.remove_suffix(1);
+
+	if (unescape(body,literal)) {
+		if (anchorStart)
+			kind= anchorEnd? MATCH_EXACT : MATCH_PREFIX;
+		else if (anchorEnd)
+			kind=MATCH_SUFFIX;
+		else
+			kind= literal.empty()? MATCH_ALL : MATCH_LITERAL;
+		return;
+	}
+	try {
+		re=std::regex(pattern,std::regex::ECMAScript|std::regex::optimize);
+		kind=MATCH_REGEX;
+		literal=leadingLiteral(pattern);
+	} catch (const std::regex_error &e) {
+		kind=MATCH_LITERAL;	// not a valid regex, look for the text as typed
+		literal=pattern;
+	}
+}
+
+bool NameMatcher::matchRegex( std::string_view name ) const {
+	const char* end=name.data()+name.size();
+	if (!literal.empty() && scanSubstring(name.data(),end,literal.data(),literal.size())==end)
+		return false;
+	return std::regex_search(name.data(),end,re);
+}
@@ -0,0 +1,202 @@
+// NAMES.CPP
+// string arena and hash index of goal names
+// Copyright 2018 Thanasis Karpetis
+//
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cstring>
+#include <functional>
+#include <algorithm>
+#include "names.h"
+
+std::string_view NameArena::add( std::string_view name ) {
+	if (name.size()>left) {
+		size_t size= name.size()>blockSize/4 ? name.size() : blockSize; // long names get their own block
+		blocks.emplace_back(new char[size]);
+		char* block=blocks.back().get();
+		if (size==blockSize) {
+			cur=block;
+			left=size;
+		}
+		else {			// keep filling the current block after a long name
+			memcpy(block,name.data(),name.size());
+			total+=name.size();
+			return std::string_view{block,name.size()};
+		}
+	}
+	memcpy(cur,name.data(),name.size());
+	std::string_view stored{cur,name.size()};
+	cur+=name.size();
+	left-=name.size();
+	total+=name.size();
+	return stored;
+}
+
+void NameArena::clear() {
+	blocks.clear();
+	cur=nullptr;
+	left=total=dropped=0;
+}
+
+uint32_t NameIndex::hashOf( std::string_view name ) {
+	size_t h=std::hash<std::string_view>{}(name);
+	return uint32_t(h^(h>>32));
+}
+
+size_t NameIndex::locate( std::string_view name, uint32_t hash ) const {
+	size_t i=hash&mask();
+	while (slots[i].idx>=0) {
+		if (slots[i].hash==hash && keys[slots[i].idx]==name)
+			break;
+		i=(i+1)&mask();
+	}
+	return i;
+}
+
+int NameIndex::find( std::string_view name ) const {
+	return slots[locate(name,hashOf(name))].idx;
+}
+
+bool NameIndex::insert( std::string_view name, int idx ) {
+	if ((used+1)*4>slots.size()*3)
+		grow();
+	uint32_t hash=hashOf(name);
+	size_t i=locate(name,hash);
+	if (slots[i].idx>=0)
+		return false;
+	slots[i]=Slot{hash,idx};
+	used++;
+	return true;
+}
+
+// pulls later members of the probe run back into the hole, so lookups never need tombstones
+void NameIndex::erase( std::string_view name ) {
+	size_t hole=locate(name,hashOf(name));
+	if (slots[hole].idx<0)
+		return;
+	size_t i=hole;
+	while (true) {
+		i=(i+1)&mask();
+		if (slots[i].idx<0)
+			break;
+		size_t home=slots[i].hash&mask();
+		// slot i may move to the hole unless its home lies cyclically in (hole,i]
+		if (((i-home)&mask()) >= ((i-hole)&mask())) {
+			slots[hole]=slots[i];
+			hole=i;
+		}
+	}
+	slots[hole].idx=-1;
+	used--;
+}
+
+// the names and so the hashes are unchanged, only the record indices are rewritten
+void NameIndex::remap( const std::vector<int> &newIndex ) {
+	for (auto &slot:slots)
+		if (slot.idx>=0)
+			slot.idx=newIndex[slot.idx];
+}
+
+void NameIndex::clear() {
+	slots.assign(16,Slot{0,-1});
+	used=0;
+}
+
+// make room for n names without rehashing
+void NameIndex::reserve( size_t n ) {
+	while (n*4>slots.size()*3)
+		grow();
+}
+
+// doubles the table, placing the members by their stored hash so no name is read
+void NameIndex::grow() {
+	std::vector<Slot> old(slots.size()*2,Slot{0,-1});
+	old.swap(slots);
+	for (auto &slot:old)
+		if (slot.idx>=0) {
+			size_t i=slot.hash&mask();
+			while (slots[i].idx>=0)
+				i=(i+1)&mask();
+			slots[i]=slot;
+		}
+}
+
+void TrigramIndex::collect( std::string_view name ) {
+	grams.clear();
+	for (size_t i=0;i+gramSize<=name.size();i++)
+		grams.push_back(uint32_t(uint8_t(name[i]))<<16 | uint32_t(uint8_t(name[i+1]))<<8 |
+				uint8_t(name[i+2]));
+	std::sort(grams.begin(),grams.end());
+	grams.erase(std::unique(grams.begin(),grams.end()),grams.end());
+}
+
+// visiting the records in increasing order leaves every list sorted
+void TrigramIndex::build( const std::vector<int> &live ) {
+	postings.clear();
+	for (int idx:live) {
+		collect(keys[idx]);
+		for (auto gram:grams)
+			postings[gram].push_back(idx);
+	}
+	built=true;
+}
+
+bool TrigramIndex::intersect( std::string_view literal, std::vector<int> &out ) {
+	out.clear();
+	collect(literal);
+	std::vector<const std::vector<int>*> lists;
+	for (auto gram:grams) {
+		auto it=postings.find(gram);
+		if (it==postings.end() || it->second.empty())
+			return true;	// no name has this trigram
+		lists.push_back(&it->second);
+	}
+	std::sort(lists.begin(),lists.end(),[]( auto a, auto b ) { return a->size()<b->size(); });
+	out=*lists[0];
+	std::vector<int> common;
+	// a handful of candidates is cheaper to verify than the remaining lists are to intersect
+	for (size_t i=1;i<lists.size() && out.size()>16;i++) {
+		common.clear();
+		std::set_intersection(out.begin(),out.end(),lists[i]->begin(),lists[i]->end(),
+				std::back_inserter(common));
+		out.swap(common);
+	}
+	return true;
+}
+
+void TrigramIndex::add( int idx ) {
+	if (!built)
+		return;
+	collect(keys[idx]);
+	for (auto gram:grams) {
+		auto &list=postings[gram];
+		if (list.empty() || list.back()<idx)
+			list.push_back(idx);	// a new record
+		else
+			list.insert(std::lower_bound(list.begin(),list.end(),idx),idx);
+	}
+}
+
+void TrigramIndex::remove( int idx ) {
+	if (!built)
+		return;
+	collect(keys[idx]);
+	for (auto gram:grams) {
+		auto &list=postings[gram];
+		auto it=std::lower_bound(list.begin(),list.end(),idx);
+		if (it!=list.end() && *it==idx)
+			list.erase(it);
+	}
+}
+
+void TrigramIndex::remap( const std::vector<int> &newIndex ) {
+	if (!built)
+		return;
+	for (auto &posting:postings) {
+		auto &list=posting.second;
+		for (auto &idx:list)
+			idx=newIndex[idx];
+		list.erase(std::remove(list.begin(),list.end(),-1),list.end());
+	}
+}
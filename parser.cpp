@@ -8,7 +8,15 @@
 #include <algorithm>
 #include <string>
 #include <iomanip>
+#include <cstring>
+#include <cerrno>
+#include <charconv>
+#include <fcntl.h>	// open()
+#include <unistd.h>	// close()
+#include <sys/mman.h>	// mmap(), munmap(), madvise()
+#include <sys/stat.h>	// fstat()
 #include "goals.h"
+#include "scanner.h"
 
 // read the XML file's header and return it withouth the <? and ?> sequences
 // the result might possibly be empty on error. Do not care for the moment
@@ -115,20 +123,143 @@ std::string XMLParser::getLeafData() {
 	return data;
 }
 		  			  
+// maps the whole file read-only. failure to open leaves the object not good(), an empty file is good but empty
+
+MappedFile::MappedFile( const std::string& name ):data{nullptr},length{0},opened{false} {
+	int fd=open(name.c_str(),O_RDONLY);
+	if (fd<0)
+		return;
+	struct stat st;
+	if (fstat(fd,&st)==0) {
+		opened=true;
+		if (st.st_size>0) {
+			void *p=mmap(nullptr,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+			if (p!=MAP_FAILED) {
+				data=static_cast<const char*>(p);
+				length=st.st_size;
+				madvise(p,length,MADV_SEQUENTIAL);// parsing is a single forward pass
+			}
+			else opened=false;
+		}
+	}
+	close(fd);// the mapping outlives the descriptor
+}
+
+MappedFile::~MappedFile() {
+	if (data!=nullptr)
+		munmap(const_cast<char*>(data),length);
+}
+
+MappedXMLParser::MappedXMLParser( const std::string& name ):file{new MappedFile{name}} {
+	cur=file->begin();
+	last=file->end();
+	opened=file->good();
+}
+
+// mapped counterpart of XMLParser::getHeader(). the header is the first line of the file
+
+std::string_view MappedXMLParser::getHeader() {
+	std::string_view header;
+	if (opened) {
+		const char* eol=(cur<last?static_cast<const char*>(memchr(cur,'\n',last-cur)):nullptr);
+		if (eol==nullptr)
+			eol=last;
+		header=std::string_view(cur,eol-cur);
+		cur=(eol<last?eol+1:last);
+		if (header.length() >4 && header.substr(0,2)=="<?" &&
+				header.substr(header.length()-2,2)=="?>")
+			header = header.substr(2,header.length()-4);
+		else	throw( std::runtime_error("header of XML file was illegal"));
+	}
+	return header;
+}
+
+// mapped counterpart of XMLParser::getLabel(), raising the same errors.
+// a label cannot contain whitespace or '<', so it is always a contiguous view.
+// jumps between structural characters with the vectorized scanner
+
+std::string_view MappedXMLParser::getLabel() {
+	while (cur<last) {
+		const char* p=scanAny(cur,last,"<>",2);// whitespace or stray characters outside labels are ignored
+		if (p==last)
+			break;
+		cur=p+1;
+		if (*p=='>')
+			throw(std::runtime_error("Label ending before it starts"));
+		if (cur<last && *cur=='!') {
+			absorbComment();
+			continue;
+		}
+		const char* first=cur;
+		p=scanAny(cur,last,"<>\t\n ",5);
+		if (p==last)
+			break;
+		cur=p+1;
+		switch(*p) {
+			case '<': throw(std::runtime_error("Label is malformed"));
+			case '>': return std::string_view(first,p-first);
+			default: throw( std::runtime_error("whitespace in label"));
+		}
+	}
+	cur=last;
+	throw (std::runtime_error ("an opened label was never closed") );
+}
+
+// mapped counterpart of XMLParser::absorbComment(). skips to one-past the "->" ending the comment
+// Prerequisite: the starting '<' of the comment has already been read and is followed by '!'
+
+void MappedXMLParser::absorbComment() {
+	cur++;// consuming the starting digraph's !
+	const char* p=scanDigraph(cur,last,'-','>');
+	if (p==last) {
+		cur=last;
+		throw ( std::runtime_error(" malformed comment"));
+	}
+	cur=p+2;
+}
+
+// mapped counterpart of XMLParser::getLeafData(). leaves the reading point on the closing label's '<'
+
+std::string_view MappedXMLParser::getLeafData() {
+	const char* first=cur;
+	cur=scanAny(cur,last,"<>\n",3);
+	if (cur==last)
+		throw( std::runtime_error("malformed file"));
+	if (*cur!='<')
+		throw( std::runtime_error(std::string(first,cur-first) +"["+*cur+"illegal characters in data"));
+	return std::string_view(first,cur-first);
+}
+		  			  
+// leading tabs come from a precomputed run, one append per line
+
+void XMLWriter::indent() {
+	static const std::string tabs(32,'\t');
+	for (int left=indentLevel; left>0; left-=tabs.size())
+		buf.append(tabs,0,std::min<size_t>(left,tabs.size()));
+}
+
+void XMLWriter::appendNumber( int value ) {
+	char digits[16];
+	auto res=std::to_chars(digits,digits+sizeof(digits),value);
+	buf.append(digits,res.ptr-digits);
+}
+
 //writes header string
 
 void XMLWriter::writeHeader() {
-	out<<"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+	buf+="<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
 }
 
 //writes openlabel, push label in label stack, increment indent level, optionally start new line
 
-void XMLWriter::openLabel(const std::string& label, bool newline) {
+void XMLWriter::openLabel(std::string_view label, bool newline) {
 	indent();
-	out<<'<'<<label<<'>';
+	buf+='<';
+	buf+=label;
+	buf+='>';
 	labelStack.emplace_back(label,newline); // will store node elements having a newline, leafs without
 	if (newline)
-		out<<'\n';
+		buf+='\n';
 	indentLevel++;
 }
 
@@ -140,14 +271,135 @@ void XMLWriter::closeLabel() {
 	indentLevel--;
 	if (labelStack.back().second) // a node element
 		indent();
-	out<<"</"<<labelStack.back().first<<">\n";
+	buf+="</";
+	buf+=labelStack.back().first;
+	buf+=">\n";
 	labelStack.pop_back();
 }
 
 
-void XMLWriter::writeLeaf( const std::string &label, const std::string &data) {
+void XMLWriter::writeLeaf( std::string_view label, std::string_view data) {
 	openLabel(label,false);// one line record
-	out<<data;
+	buf+=data;
+	closeLabel();
+}
+
+void XMLWriter::writeLeaf( std::string_view label, int data) {
+	openLabel(label,false);
+	appendNumber(data);
 	closeLabel();
 }
 
+void XMLWriter::writeLeaf( std::string_view label, double data, int decimals) {
+	openLabel(label,false);
+	char digits[64];
+	auto res=std::to_chars(digits,digits+sizeof(digits),data,std::chars_format::fixed,decimals);
+	if (res.ec!=std::errc())	// too large for a fixed-point field
+		res=std::to_chars(digits,digits+sizeof(digits),data);
+	buf.append(digits,res.ptr-digits);
+	closeLabel();
+}
+
+// writes the whole document out, see atomicReplace()
+
+void XMLWriter::flush( bool keepBackup, const std::function<void(int)> &beforeRename ) {
+	atomicReplace(filename,buf,keepBackup,beforeRename);
+	buf.clear();
+}
+
+namespace {
+
+// closes a descriptor on every exit path
+struct FileDescriptor {
+	int fd;
+	FileDescriptor( int d ):fd{d} {}
+	~FileDescriptor() { if (fd>=0) close(fd); }
+};
+
+std::runtime_error fileError( const std::string &what, const std::string &name ) {
+	return std::runtime_error(what+" "+name+": "+strerror(errno));
+}
+
+// a single write(2) in practice, looping only if the kernel accepts part of the data
+void writeAll( int fd, const char* p, size_t left, const std::string &name ) {
+	while (left>0) {
+		ssize_t written=write(fd,p,left);
+		if (written<0 && errno==EINTR)
+			continue;
+		if (written<=0)
+			throw fileError("cannot write",name);
+		p+=written;
+		left-=written;
+	}
+}
+
+// persist a rename by syncing the directory holding name
+void syncDirectory( const std::string &name ) {
+	size_t slash=name.rfind('/');
+	std::string dir= (slash==std::string::npos? "." : name.substr(0,slash+1));
+	FileDescriptor d{open(dir.c_str(),O_RDONLY|O_DIRECTORY)};
+	if (d.fd>=0)
+		fsync(d.fd);
+}
+
+} // namespace
+
+void atomicReplace( const std::string &name, std::string_view data, bool keepBackup,
+		const std::function<void(int)> &beforeRename ) {
+	std::string tmpName=name+".tmpXXXXXX";// same directory, so rename() cannot cross filesystems
+	FileDescriptor tmp{mkstemp(&tmpName[0])};
+	if (tmp.fd<0)
+		throw fileError("cannot create temporary file for",name);
+	try {
+		struct stat st;
+		fchmod(tmp.fd, stat(name.c_str(),&st)==0 ? (st.st_mode&07777) : 0644);// mkstemp uses 0600
+		writeAll(tmp.fd,data.data(),data.size(),tmpName);
+		if (fsync(tmp.fd)!=0)
+			throw fileError("cannot sync",tmpName);
+		if (keepBackup)
+			backupFile(name);
+		if (beforeRename)
+			beforeRename(tmp.fd);
+		if (rename(tmpName.c_str(),name.c_str())!=0)
+			throw fileError("cannot rename over",name);
+	} catch (...) {
+		unlink(tmpName.c_str());
+		throw;
+	}
+	syncDirectory(name);
+}
+
+bool backupFile( const std::string &name ) {
+	std::string bak=name+".bak";
+	unlink(bak.c_str());
+	if (link(name.c_str(),bak.c_str())==0)
+		return true;	// the old inode survives the rename as the backup
+	if (errno==ENOENT)
+		return false;	// nothing to back up yet
+
+	FileDescriptor in{open(name.c_str(),O_RDONLY)};
+	if (in.fd<0)
+		return false;
+	struct stat st;
+	if (fstat(in.fd,&st)!=0)
+		return false;
+	std::string tmpName=bak+".tmpXXXXXX";
+	FileDescriptor out{mkstemp(&tmpName[0])};
+	if (out.fd<0)
+		return false;
+	fchmod(out.fd,st.st_mode&07777);
+	off_t left=st.st_size;
+	while (left>0) {
+		ssize_t copied=copy_file_range(in.fd,nullptr,out.fd,nullptr,left,0);
+		if (copied<=0) {
+			unlink(tmpName.c_str());
+			return false;
+		}
+		left-=copied;
+	}
+	if (rename(tmpName.c_str(),bak.c_str())!=0) {
+		unlink(tmpName.c_str());
+		return false;
+	}
+	return true;
+}
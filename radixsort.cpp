@@ -0,0 +1,105 @@
+// RADIXSORT.CPP
+// LSD radix sort of record indices by packed numeric sort keys
+// Copyright 2018 Thanasis Karpetis
+//
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#include <array>
+#include <cstring>
+#include <algorithm>
+#include "radixsort.h"
+
+namespace {
+
+const size_t radixMin=1024;	// below this std::sort wins, the passes have a fixed cost
+
+struct Keyed {
+	uint64_t low;		// bits 0-63 of the packed key
+	uint16_t high;		// bits 64-79
+	int idx;
+};
+
+// a double's bits as an unsigned integer ordered like the double: negative values have every
+// bit flipped, the others only the sign bit
+uint64_t costBits( double cost ) {
+	if (cost==0.)
+		cost=0.;	// -0.0 compares equal to 0.0 and must sort with it
+	uint64_t bits;
+	memcpy(&bits,&cost,sizeof(bits));
+	return (bits>>63)? ~bits : bits|(uint64_t(1)<<63);
+}
+
+unsigned byteOf( const Keyed &k, int d ) {
+	return d<8? (k.low>>(8*d))&255 : (k.high>>(8*(d-8)))&255;
+}
+
+} // namespace
+
+bool radixSort( int *order, int *last, const GoalColumns &records, const SortSpec &spec ) {
+	int numeric=0;		// the leading keys that can be packed
+	int width=0;		// their bits
+	while (numeric<spec.size() && spec[numeric].field!=SortKey::NAME)
+		width+= (spec[numeric++].field==SortKey::UNITCOST? 64 : 8);
+	size_t n=last-order;
+	if (numeric==0 || n<radixMin)
+		return false;
+
+	std::vector<Keyed> keyed(n), scratch(n);
+	for (size_t i=0;i<n;i++) {
+		int idx=order[i];
+		unsigned __int128 key=0;
+		for (int k=0;k<numeric;k++) {
+			uint64_t part;
+			int bits=8;
+			switch (spec[k].field) {
+				case SortKey::PRIORITY: part=records.priority(idx); break;
+				case SortKey::COMPLETION: part=records.completion(idx); break;
+				default: part=costBits(records.unitcost(idx)); bits=64; break;
+			}
+			if (spec[k].descending)
+				part= (bits==64? ~part : part^255);
+			key=key<<bits | part;
+		}
+		keyed[i]=Keyed{uint64_t(key),uint16_t(key>>64),idx};
+	}
+
+	// one pass counts every byte position, positions all records share need no pass of their own
+	int bytes=width/8;
+	std::vector<std::array<size_t,256>> counts(bytes);
+	for (auto &c:counts)
+		c.fill(0);
+	for (auto &k:keyed)
+		for (int d=0;d<bytes;d++)
+			counts[d][byteOf(k,d)]++;
+	for (int d=0;d<bytes;d++) {
+		auto &c=counts[d];
+		if (c[byteOf(keyed[0],d)]==n)
+			continue;
+		size_t offset=0;
+		for (auto &count:c) {
+			size_t next=offset+count;
+			count=offset;
+			offset=next;
+		}
+		for (auto &k:keyed)
+			scratch[c[byteOf(k,d)]++]=k;
+		keyed.swap(scratch);
+	}
+
+	for (size_t i=0;i<n;i++)
+		order[i]=keyed[i].idx;
+	// the records the packed key left tied are ordered by the keys after it, if any, and by index.
+	// The stable passes keep index order when the input had it, but nth_element may have permuted it
+	auto tieLess=[&]( int a, int b ) {
+		return lessFrom(records,spec,numeric,a,b);
+	};
+	for (size_t first=0,last; first<n; first=last) {
+		last=first+1;
+		while (last<n && keyed[last].low==keyed[first].low && keyed[last].high==keyed[first].high)
+			last++;
+		if (last-first>1 && !std::is_sorted(order+first,order+last,tieLess))
+			std::sort(order+first,order+last,tieLess);
+	}
+	return true;
+}
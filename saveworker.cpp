@@ -0,0 +1,72 @@
+// SAVEWORKER.CPP
+// implementation of the background save thread
+// Copyright 2018 Thanasis Karpetis
+//
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#include <exception>
+#include "saveworker.h"
+
+SaveWorker::~SaveWorker() {
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		stopping=true;
+	}
+	wake.notify_all();
+	if (worker.joinable())
+		worker.join();
+}
+
+void SaveWorker::workerLoop() {
+	std::unique_lock<std::mutex> lock(mtx);
+	while (true) {
+		wake.wait(lock,[&]{ return stopping || pending; });
+		if (!pending)
+			return;		// stopping, with nothing left to save
+		std::function<void()> task;
+		task.swap(pending);
+		running=true;
+		lock.unlock();
+		std::string error;
+		try {
+			task();
+		} catch (std::exception &e) {
+			error=e.what();
+		}
+		lock.lock();
+		running=false;
+		if (!error.empty())
+			failures+= (failures.empty()? "" : "\n")+error;
+		if (!pending)
+			idle.notify_all();
+	}
+}
+
+void SaveWorker::submit( std::function<void()> task ) {
+	std::lock_guard<std::mutex> lock(mtx);
+	pending=std::move(task);
+	if (!worker.joinable())
+		worker=std::thread(&SaveWorker::workerLoop,this);
+	wake.notify_one();
+}
+
+std::string SaveWorker::wait() {
+	std::unique_lock<std::mutex> lock(mtx);
+	idle.wait(lock,[&]{ return !running && !pending; });
+	std::string res;
+	res.swap(failures);
+	return res;
+}
+
+std::string SaveWorker::errors() {
+	std::lock_guard<std::mutex> lock(mtx);
+	std::string res;
+	res.swap(failures);
+	return res;
+}
+
+bool SaveWorker::busy() {
+	std::lock_guard<std::mutex> lock(mtx);
+	return running || pending;
+}
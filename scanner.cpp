@@ -0,0 +1,205 @@
+// SCANNER.CPP
+// scalar, SSE2 and AVX2 implementations of the parser's delimiter searches
+// Copyright 2018 Thanasis Karpetis
+//
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cstring>
+#include <string_view>
+#include "scanner.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+ #define SCANNER_X86
+ #include <immintrin.h>
+#endif
+
+namespace {
+
+//---------- scalar versions, also finishing the tails of the vector loops ----------
+
+const char* scanAnyScalar( const char* p, const char* end, const char* set, int n ) {
+	for ( ; p<end; p++)
+		for (int i=0;i<n;i++)
+			if (*p==set[i])
+				return p;
+	return end;
+}
+
+const char* scanDigraphScalar( const char* p, const char* end, char a, char b ) {
+	for ( ; p+1<end; p++)
+		if (p[0]==a && p[1]==b)
+			return p;
+	return end;
+}
+
+const char* scanSubstringScalar( const char* p, const char* end, const char* needle, size_t n ) {
+	size_t at=std::string_view(p,end-p).find(std::string_view(needle,n));
+	return at==std::string_view::npos? end : p+at;
+}
+
+#ifdef SCANNER_X86
+//---------- SSE2, 16 bytes per step ----------
+
+const char* scanAnySSE2( const char* p, const char* end, const char* set, int n ) {
+	__m128i needles[5];
+	for (int i=0;i<n;i++)
+		needles[i]=_mm_set1_epi8(set[i]);
+	for ( ; p+16<=end; p+=16) {
+		__m128i block=_mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i hits=_mm_cmpeq_epi8(block,needles[0]);
+		for (int i=1;i<n;i++)
+			hits=_mm_or_si128(hits,_mm_cmpeq_epi8(block,needles[i]));
+		int mask=_mm_movemask_epi8(hits);
+		if (mask)
+			return p+__builtin_ctz(mask);
+	}
+	return scanAnyScalar(p,end,set,n);
+}
+
+const char* scanDigraphSSE2( const char* p, const char* end, char a, char b ) {
+	__m128i first=_mm_set1_epi8(a);
+	__m128i second=_mm_set1_epi8(b);
+	for ( ; p+17<=end; p+=16) {	// the second load reaches one byte further
+		__m128i block=_mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i next=_mm_loadu_si128(reinterpret_cast<const __m128i*>(p+1));
+		int mask=_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block,first),
+							_mm_cmpeq_epi8(next,second)));
+		if (mask)
+			return p+__builtin_ctz(mask);
+	}
+	return scanDigraphScalar(p,end,a,b);
+}
+
+// candidates are the positions where both the first and the last byte of needle match,
+// only those are compared in full
+const char* scanSubstringSSE2( const char* p, const char* end, const char* needle, size_t n ) {
+	if (n==0 || (size_t)(end-p)<n)
+		return n==0? p : end;
+	__m128i first=_mm_set1_epi8(needle[0]);
+	__m128i last=_mm_set1_epi8(needle[n-1]);
+	for ( ; p+n-1+16<=end; p+=16) {	// the second load starts n-1 bytes further
+		__m128i head=_mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i tail=_mm_loadu_si128(reinterpret_cast<const __m128i*>(p+n-1));
+		unsigned mask=_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(head,first),
+							_mm_cmpeq_epi8(tail,last)));
+		for ( ; mask; mask&=mask-1) {
+			int i=__builtin_ctz(mask);
+			if (n<=2 || memcmp(p+i+1,needle+1,n-2)==0)
+				return p+i;
+		}
+	}
+	return scanSubstringScalar(p,end,needle,n);
+}
+
+//---------- AVX2, 32 bytes per step, compiled for the target even when the build is not ----------
+
+__attribute__((target("avx2")))
+const char* scanAnyAVX2( const char* p, const char* end, const char* set, int n ) {
+	__m256i needles[5];
+	for (int i=0;i<n;i++)
+		needles[i]=_mm256_set1_epi8(set[i]);
+	for ( ; p+32<=end; p+=32) {
+		__m256i block=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		__m256i hits=_mm256_cmpeq_epi8(block,needles[0]);
+		for (int i=1;i<n;i++)
+			hits=_mm256_or_si256(hits,_mm256_cmpeq_epi8(block,needles[i]));
+		unsigned mask=_mm256_movemask_epi8(hits);
+		if (mask)
+			return p+__builtin_ctz(mask);
+	}
+	return scanAnySSE2(p,end,set,n);
+}
+
+__attribute__((target("avx2")))
+const char* scanDigraphAVX2( const char* p, const char* end, char a, char b ) {
+	__m256i first=_mm256_set1_epi8(a);
+	__m256i second=_mm256_set1_epi8(b);
+	for ( ; p+33<=end; p+=32) {
+		__m256i block=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		__m256i next=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p+1));
+		unsigned mask=_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block,first),
+								_mm256_cmpeq_epi8(next,second)));
+		if (mask)
+			return p+__builtin_ctz(mask);
+	}
+	return scanDigraphSSE2(p,end,a,b);
+}
+
+__attribute__((target("avx2")))
+const char* scanSubstringAVX2( const char* p, const char* end, const char* needle, size_t n ) {
+	if (n==0 || (size_t)(end-p)<n)
+		return n==0? p : end;
+	__m256i first=_mm256_set1_epi8(needle[0]);
+	__m256i last=_mm256_set1_epi8(needle[n-1]);
+	for ( ; p+n-1+32<=end; p+=32) {
+		__m256i head=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		__m256i tail=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p+n-1));
+		unsigned mask=_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(head,first),
+								_mm256_cmpeq_epi8(tail,last)));
+		for ( ; mask; mask&=mask-1) {
+			int i=__builtin_ctz(mask);
+			if (n<=2 || memcmp(p+i+1,needle+1,n-2)==0)
+				return p+i;
+		}
+	}
+	return scanSubstringSSE2(p,end,needle,n);
+}
+#endif //SCANNER_X86
+
+typedef const char* (*ScanAnyFn)( const char*, const char*, const char*, int );
+typedef const char* (*ScanDigraphFn)( const char*, const char*, char, char );
+typedef const char* (*ScanSubstringFn)( const char*, const char*, const char*, size_t );
+
+// currently selected implementations, resolved once at startup
+ScanLevel level=bestScanLevel();
+ScanAnyFn anyFn=scanAnyScalar;
+ScanDigraphFn digraphFn=scanDigraphScalar;
+ScanSubstringFn substringFn=scanSubstringScalar;
+bool selected=(setScanLevel(level),true);
+
+} // namespace
+
+const char* scanAny( const char* p, const char* end, const char* set, int n ) {
+	return anyFn(p,end,set,n);
+}
+
+const char* scanDigraph( const char* p, const char* end, char a, char b ) {
+	return digraphFn(p,end,a,b);
+}
+
+const char* scanSubstring( const char* p, const char* end, const char* needle, size_t n ) {
+	return substringFn(p,end,needle,n);
+}
+
+ScanLevel bestScanLevel() {
+#ifdef SCANNER_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return SCAN_AVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return SCAN_SSE2;
+#endif
+	return SCAN_SCALAR;
+}
+
+ScanLevel getScanLevel() {
+	return level;
+}
+
+ScanLevel setScanLevel( ScanLevel newLevel ) {
+	if (newLevel>bestScanLevel())
+		newLevel=bestScanLevel();
+	level=newLevel;
+	switch (level) {
+#ifdef SCANNER_X86
+		case SCAN_AVX2:
+			anyFn=scanAnyAVX2; digraphFn=scanDigraphAVX2; substringFn=scanSubstringAVX2; break;
+		case SCAN_SSE2:
+			anyFn=scanAnySSE2; digraphFn=scanDigraphSSE2; substringFn=scanSubstringSSE2; break;
+#endif
+		default:
+			anyFn=scanAnyScalar; digraphFn=scanDigraphScalar; substringFn=scanSubstringScalar; break;
+	}
+	return level;
+}
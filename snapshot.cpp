@@ -0,0 +1,143 @@
+// SNAPSHOT.CPP
+// binary snapshot of the goal records, written next to the xml file to speed up startup
+// Copyright 2018 Thanasis Karpetis
+//
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cstring>
+#include <cstdint>
+#include "goals.h"
+#include "journal.h"
+
+// Layout, in host byte order since the snapshot is a cache of the xml file and never shared:
+//	header		magic, version, record count, name table size, signature of the xml file it mirrors
+//	uint64_t	name offsets[count+1]	string table index, name i spans [offset[i],offset[i+1])
+//	char		names[]			concatenated names, padded to 8 bytes
+//	double		unitcost[count]
+//	int32_t		priority[count]
+//	int32_t		completion[count]
+
+namespace {
+
+const char snapshotMagic[8]={'G','O','A','L','S','N','A','P'};
+const uint32_t snapshotVersion=2;
+
+struct SnapshotHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+	uint64_t count;
+	uint64_t nameBytes;
+	FileSignature source;	// the xml file the snapshot was taken from, see journal.h
+};
+
+size_t padded( size_t n ) { return (n+7)&~size_t(7); }
+
+template <class T>
+void append( std::string &buf, const T &value ) {
+	buf.append(reinterpret_cast<const char*>(&value),sizeof(T));
+}
+
+} // namespace
+
+std::string GoalContainer::snapshotName( const std::string &xmlName ) {
+	return xmlName+".bin";
+}
+
+// writes the records saved in the xml file, in file order. called after the xml file has been saved
+bool GoalContainer::saveSnapshot( const std::string &xmlName, const GoalColumns &records ) {
+	FileSignature xml=FileSignature::of(xmlName);
+	if (xml==FileSignature{})
+		return false;
+
+	SnapshotHeader header;
+	memcpy(header.magic,snapshotMagic,sizeof(header.magic));
+	header.version=snapshotVersion;
+	header.reserved=0;
+	header.count=records.size();
+	header.nameBytes=0;
+	for (size_t i=0;i<records.size();i++)
+		header.nameBytes+=records.name(i).size();
+	header.source=xml;
+
+	std::string buf;
+	buf.reserve(sizeof(header)+(header.count+1)*8+padded(header.nameBytes)+header.count*16);
+	append(buf,header);
+	uint64_t offset=0;
+	for (size_t i=0;i<records.size();i++) {
+		append(buf,offset);
+		offset+=records.name(i).size();
+	}
+	append(buf,offset);
+	for (size_t i=0;i<records.size();i++)
+		buf+=records.name(i);
+	buf.resize(padded(buf.size()),'\0');
+	for (size_t i=0;i<records.size();i++)
+		append(buf,records.unitcost(i));
+	for (size_t i=0;i<records.size();i++)
+		append(buf,int32_t(records.priority(i)));
+	for (size_t i=0;i<records.size();i++)
+		append(buf,int32_t(records.completion(i)));
+
+	try {
+		atomicReplace(snapshotName(xmlName),buf);
+	} catch (std::exception &e) {
+		std::cerr<<e.what()<<'\n';
+		return false;
+	}
+	return true;
+}
+
+// loads the records from the snapshot if it was taken from exactly this xml file: same size,
+// modification time and inode. An edited, replaced or restored file, such as a .bak moved back,
+// differs in one of them. returns false, having loaded nothing, when the xml file must be parsed instead
+bool GoalContainer::loadSnapshot() {
+	FileSignature xml=FileSignature::of(filename);
+	if (xml==FileSignature{} || FileSignature::of(snapshotName(filename))==FileSignature{})
+		return false;
+
+	MappedFile file{snapshotName(filename)};
+	SnapshotHeader header;
+	if (file.size()<sizeof(header))
+		return false;
+	memcpy(&header,file.begin(),sizeof(header));
+	if (memcmp(header.magic,snapshotMagic,sizeof(header.magic))!=0 || header.version!=snapshotVersion ||
+			!(header.source==xml))
+		return false;
+	uint64_t count=header.count;
+	size_t offsetsAt=sizeof(header);
+	size_t namesAt=offsetsAt+(count+1)*sizeof(uint64_t);
+	size_t costsAt=namesAt+padded(header.nameBytes);
+	size_t prioritiesAt=costsAt+count*sizeof(double);
+	size_t completionsAt=prioritiesAt+count*sizeof(int32_t);
+	if (count>file.size() || header.nameBytes>file.size() ||
+			completionsAt+count*sizeof(int32_t)!=file.size())
+		return false;	// truncated or foreign file
+
+	const char* base=file.begin();
+	auto offsets=reinterpret_cast<const uint64_t*>(base+offsetsAt);
+	auto costs=reinterpret_cast<const double*>(base+costsAt);
+	auto priorities=reinterpret_cast<const int32_t*>(base+prioritiesAt);
+	auto completions=reinterpret_cast<const int32_t*>(base+completionsAt);
+	if (offsets[count]!=header.nameBytes)
+		return false;
+	for (uint64_t i=0;i<count;i++)
+		if (offsets[i]>offsets[i+1] || priorities[i]<0 || priorities[i]>100 ||
+				completions[i]<0 || completions[i]>100)
+			return false;
+
+	v.reserve(count);
+	names.reserve(count);
+	byPriority.reserve(count);
+	byCompletion.reserve(count);
+	Goal goal;
+	for (uint64_t i=0;i<count;i++) {
+		goal.name.assign(base+namesAt+offsets[i],offsets[i+1]-offsets[i]);
+		goal.priority=priorities[i];
+		goal.completion=completions[i];
+		goal.unitcost=costs[i];
+		insertGoal(goal);
+	}
+	return true;
+}
@@ -8,6 +8,7 @@
 // file LICENSE or http://www.opensource.org/licenses/mit-license.php.
 
 #include "statemachine.h"
+#include "threadpool.h"
 #include <unistd.h> // for STDOUT_FILENO
 
 
@@ -36,11 +37,11 @@ void ExitMenu::input() {
 void ExitMenu::act() {
 	if (StateMachine::getInstance().getGC().isModified()) {
 		if (saveChanges) {
-			std::cout<<"Saving changes...";
-			StateMachine::getInstance().getGC().saveFile();
-			std::cout<<"done.\n";
+			std::cout<<"Saving changes...\n";
+			StateMachine::getInstance().getGC().saveInBackground();// run() waits for it before returning
 		}
 		else {
+			StateMachine::getInstance().getGC().discardChanges();// journaled edits are dropped
 			std::cout<<"Ignoring changes.\n";
 		}
 	}
@@ -71,21 +72,18 @@ void MainMenu::display() {
 
 int MainMenu::showGoals(int firstRecord) {
 	prevShown = firstRecord;
-	Goal searchCriteria=UserOptions::getInstance().getSearchCriteria();
+	const SearchCriteria &searchCriteria=UserOptions::getInstance().getSearchCriteria();
 	std::cout<<"GOALS:";
 	std::cout<<std::setfill(' ')<<std::setw(30)<<"\t[ File: "<<StateMachine::getInstance().getGC().size()<<" ]";
 	std::cout<<" [ Current: "<<StateMachine::getInstance().getGC().activesize()<<" ]";
 	std::cout<<" [ Search: "<<StateMachine::getInstance().getGC().searchsize()<<" ]\n";
 	std::cout<<std::setfill(' ')<<std::setw(40)<<'['+searchCriteria.name+']';
-	if (searchCriteria.priority>-1)
-		std::cout<<'['<<std::setfill(' ')<<std::setw(3)<<searchCriteria.priority<<']';
-	else std::cout<<"[ - ]";
-	if (searchCriteria.completion>-1)
-		std::cout<<'['<<std::setfill(' ')<<std::setw(3)<<searchCriteria.completion<<']';
-	else std::cout<<"[ - ]";
-	if (searchCriteria.unitcost>-1.)
-		std::cout<<'['<<std::setfill(' ')<<std::setw(7)<<searchCriteria.unitcost<<']';
-	else std::cout<<"[  -  ]";
+	std::cout<<'['<<std::setfill(' ')<<std::setw(3)<<SearchCriteria::rangeText(searchCriteria.minPriority,
+				searchCriteria.maxPriority,0,100)<<']';
+	std::cout<<'['<<std::setfill(' ')<<std::setw(3)<<SearchCriteria::rangeText(searchCriteria.minCompletion,
+				searchCriteria.maxCompletion,0,100)<<']';
+	std::cout<<'['<<std::setfill(' ')<<std::setw(7)<<SearchCriteria::rangeText(searchCriteria.minCost,
+				searchCriteria.maxCost,0.,HUGE_VAL)<<']';
 
 	std::cout<<std::setfill(' ')<<std::setw(10)<<'['+UserOptions::getInstance().getSortPrefs()+']'<<'\n';
 	std::cout<<std::setfill('=')<<std::setw(80)<<"\n";
@@ -373,8 +371,8 @@ void InsertState::act() {
 // display search banner
 void SearchState::display() {
 	if (state==STATE_INPUT) {
-		std::cout<<"Current filters: \t\t["<<modGoal.goal.name<<"], ["<<modGoal.goal.priority<<"], ";
-		std::cout<<"["<<modGoal.goal.completion<<"], ["<<modGoal.goal.unitcost<<"]\n";
+		std::cout<<"Current filters:\n";
+		modGoal.criteria.print(std::cout);
 		std::cout<<"e(dit), r(eset), (b)ack :\n";
 	}
 }
@@ -396,7 +394,7 @@ void SearchState::input() {
 // handle control of goal record editing to ModifyState, act appropriately upon return
 void SearchState::act() {
 		switch(state) {
-		case STATE_RESET: modGoal.goal=Goal("",-1,-1,-1.);
+		case STATE_RESET: modGoal.criteria=SearchCriteria{};
 				  modGoal.modified=true;
 				  modGoal.validated=true;
 				  std::cout<<"All filters removed.\n";
@@ -408,7 +406,7 @@ void SearchState::act() {
 				  break;
 
 		case STATE_DONE:  if (modGoal.validated) {
-					  UserOptions::getInstance().setSearchCriteria(modGoal.goal); 
+					  UserOptions::getInstance().setSearchCriteria(modGoal.criteria); 
 				  	  std::cout<<"New filter values set.\n";
 				  }
 				  StateMachine::getInstance().setNextStateID( STATE_MAINMENU );
@@ -438,30 +436,34 @@ void EditorState::display() {
 					modGoalPtr->goal.print(std::cout);
 				case ModGoal::MODE_SEARCH:
 					std::cout<<"Search criteria are ";
-					if (modGoalPtr->goal==Goal("",-1,-1,-1.))
-						std::cout<<"disabled.";
+					if (modGoalPtr->criteria.isEmpty())
+						std::cout<<"disabled.\n";
 					else { 
-
-						std::cout<<"\t\t["<<modGoalPtr->goal.name<<"], [";
-						std::cout<<modGoalPtr->goal.priority<<"], ";
-						std::cout<<"["<<modGoalPtr->goal.completion<<"], [";
-						std::cout<<modGoalPtr->goal.unitcost<<"]";
+						std::cout<<'\n';
+						modGoalPtr->criteria.print(std::cout);
 					}
-					std::cout<<"\n";
 			}
 			break;
 		case EDITOR_FIELDCHOICE:
 			std::cout<<"Choose field to edit [(n)ame,(p)riority,(c)ompletion,(u)nit cost] or (d)one:";
 			break;	
 		case EDITOR_VALIDATION:
-			if (tmpModGoal.mode!=ModGoal::MODE_INSERT) {
-				//show previous values
+			if (tmpModGoal.mode==ModGoal::MODE_SEARCH) {
 				std::cout<<"Previous value:\n";
-				modGoalPtr->goal.print(std::cout);
+				modGoalPtr->criteria.print(std::cout);
+				std::cout<<" New values:\n";
+				tmpModGoal.criteria.print(std::cout);
+			}
+			else {
+				if (tmpModGoal.mode!=ModGoal::MODE_INSERT) {
+					//show previous values
+					std::cout<<"Previous value:\n";
+					modGoalPtr->goal.print(std::cout);
+				}
+				//show current values and ask if user wants to commit changes	
+				std::cout<<" New values:\n";
+				tmpModGoal.goal.print(std::cout);
 			}
-			//show current values and ask if user wants to commit changes	
-			std::cout<<" New values:\n";
-			tmpModGoal.goal.print(std::cout);
 			std::cout<<"\n COMMIT CHANGES(y,n)?";	
 			break;
 		default: break;
@@ -518,10 +520,14 @@ void EditorState::act() {
 							tmpModGoal.modified=true; //a new record or a modified existing one
 					} 
 				}
-				else if (name!=modGoalPtr->goal.name)
+				else if (name!=modGoalPtr->criteria.name)
 					tmpModGoal.modified=true;// any change will do.
 
-				if (ok) {
+				if (tmpModGoal.mode==ModGoal::MODE_SEARCH) {
+					tmpModGoal.criteria.name=name;
+					editState=EDITOR_FIELDCHOICE;
+				}
+				else if (ok) {
 					tmpModGoal.goal.name=name;
 					editState= ( (tmpModGoal.mode==ModGoal::MODE_INSERT)?EDITOR_PRIORITY:EDITOR_FIELDCHOICE ); 
 				}
@@ -529,6 +535,11 @@ void EditorState::act() {
 			}
 		case EDITOR_PRIORITY: 
 			{
+				if (tmpModGoal.mode==ModGoal::MODE_SEARCH) {
+					getRange("Priority",tmpModGoal.criteria.minPriority,tmpModGoal.criteria.maxPriority,0,100);
+					editState=EDITOR_FIELDCHOICE;
+					break;
+				}
 				tmpModGoal.goal.priority=getPriority();
 				if (tmpModGoal.goal.priority!=modGoalPtr->goal.priority)
 					tmpModGoal.modified=true;// for new records modified flag is already set by name
@@ -537,6 +548,12 @@ void EditorState::act() {
 			}
 		case EDITOR_COMPLETION:
 			{	
+				if (tmpModGoal.mode==ModGoal::MODE_SEARCH) {
+					getRange("Completion",tmpModGoal.criteria.minCompletion,
+							tmpModGoal.criteria.maxCompletion,0,100);
+					editState=EDITOR_FIELDCHOICE;
+					break;
+				}
 				tmpModGoal.goal.completion = getCompletion();
 				if (tmpModGoal.goal.completion!=modGoalPtr->goal.completion)
 					tmpModGoal.modified=true;
@@ -545,6 +562,12 @@ void EditorState::act() {
 			}
 		case EDITOR_UNITCOST: 
 			{
+				if (tmpModGoal.mode==ModGoal::MODE_SEARCH) {
+					getRange("UnitCost",tmpModGoal.criteria.minCost,tmpModGoal.criteria.maxCost,
+							0.,HUGE_VAL);
+					editState=EDITOR_FIELDCHOICE;
+					break;
+				}
 				tmpModGoal.goal.unitcost = getUnitCost();
 				if (tmpModGoal.goal.unitcost!=modGoalPtr->goal.unitcost)
 					tmpModGoal.modified=true;
@@ -567,7 +590,7 @@ std::string EditorState::getName() {
 	std::string name;
 	if (tmpModGoal.mode==ModGoal::MODE_SEARCH) {
 		std::cin.get();
-		std::cout<<"Name filter was:["<<tmpModGoal.goal.name<<"]\n";
+		std::cout<<"Name filter was:["<<tmpModGoal.criteria.name<<"]\n";
 		std::cout<<"New filter (regex):";
 		std::getline(std::cin,name);
 	}
@@ -584,57 +607,54 @@ std::string EditorState::getName() {
 
 int EditorState::getPriority() {
 	int priority=-1;
-	if (tmpModGoal.mode==ModGoal::MODE_SEARCH) {
-		std::cout<<"Priority filter was:["<<tmpModGoal.goal.priority<<"]\n";
-		std::cout<<"New filter (-1 to disable):";
+	while (priority<0 || priority>100) {
+		if (tmpModGoal.mode!=ModGoal::MODE_INSERT)
+			std::cout<<"Priority was: "<<tmpModGoal.goal.priority<<'\n';
+		std::cout<<"Priority [0-100]: ";
 		std::cin>>priority;
 	}
-	else {
-		while (priority<0 || priority>100) {
-			if (tmpModGoal.mode!=ModGoal::MODE_INSERT)
-				std::cout<<"Priority was: "<<tmpModGoal.goal.priority<<'\n';
-			std::cout<<"Priority [0-100]: ";
-			std::cin>>priority;
-		}
-	}	
 	return priority;
 }
 
 int EditorState::getCompletion() {
 	int completion=-1;
-	if (tmpModGoal.mode==ModGoal::MODE_SEARCH) {
-		std::cout<<"Completion filter was:["<<tmpModGoal.goal.completion<<"]\n";
-		std::cout<<"New filter (-1 to disable):";
+	while ( completion<0 || completion>100) {
+		if (tmpModGoal.mode!=ModGoal::MODE_INSERT)
+			std::cout<<"Completion % was: "<<tmpModGoal.goal.completion<<'\n';
+		std::cout<<"% completed [0-100]: ";
 		std::cin>>completion;
 	}
-	else {
-		while ( completion<0 || completion>100) {
-			if (tmpModGoal.mode!=ModGoal::MODE_INSERT)
-				std::cout<<"Completion % was: "<<tmpModGoal.goal.completion<<'\n';
-			std::cout<<"% completed [0-100]: ";
-			std::cin>>completion;
-		}
-	}	
 	return completion;
 }
 
 double EditorState::getUnitCost() {
 	double unitcost=0.;
-	if (tmpModGoal.mode==ModGoal::MODE_SEARCH) {
-		std::cout<<"UnitCost filter was:["<<tmpModGoal.goal.unitcost<<"]\n";
-		std::cout<<"New filter (<0. to disable):";
+	while ( unitcost<0.00001) {
+		if (tmpModGoal.mode!=ModGoal::MODE_INSERT)
+			std::cout<<"Time cost was: "<<tmpModGoal.goal.unitcost<<'\n';
+		std::cout<<"Time cost per 1% in hours (positive float) : ";
 		std::cin>>unitcost;
 	}
-	else {
-		while ( unitcost<0.00001) {
-			if (tmpModGoal.mode!=ModGoal::MODE_INSERT)
-				std::cout<<"Time cost was: "<<tmpModGoal.goal.unitcost<<'\n';
-			std::cout<<"Time cost per 1% in hours (positive float) : ";
-			std::cin>>unitcost;
-		}
-	}
 	return unitcost;
 }
+
+// reads a range filter of one field, see SearchCriteria::parseRange() for what is accepted
+template <class T>
+void EditorState::getRange( const char* field, T &lo, T &hi, T min, T max ) {
+	std::string text;
+	std::cout<<field<<" filter was:["<<SearchCriteria::rangeText(lo,hi,min,max)<<"]\n";
+	std::cout<<"New filter (x, >x, >=x, <x, <=x, x-y, - to disable):";
+	std::cin>>std::ws;
+	std::getline(std::cin,text);
+	T newLo=lo, newHi=hi;
+	if (!SearchCriteria::parseRange(text,newLo,newHi,min,max))
+		std::cout<<"Invalid filter ["<<text<<"], left unchanged.\n";
+	else if (newLo!=lo || newHi!=hi) {
+		lo=newLo;
+		hi=newHi;
+		tmpModGoal.modified=true;
+	}
+}
 //--------------------------------------------------------------------------------
 // set the machine to the new state, pushing previous in the stack
 // this is called periodically by the run()'s loop
@@ -693,6 +713,7 @@ void StateMachine::queryConsoleDimensions() {
 int StateMachine::run() {
 	bool done=false;
 	UserOptions::getInstance().loadFile("options.xml");
+	ThreadPool::getInstance().resize(UserOptions::getInstance().getThreads());
 	try {
 		gc.loadFile("goals.xml");
 	} catch( std::exception &e) {
@@ -708,6 +729,7 @@ int StateMachine::run() {
 
 		if (UserOptions::getInstance().getPaging())
 			queryConsoleDimensions();
+		gc.autosave(); // hands a copy of the records to the save worker when the interval has passed
 		gc.searchGoals(); // only if flagged so
 		gc.sortGoals(); // will sort only when the sorting preference string has been changed
 		//std::cerr<<"Terminal Dimensions: "<<termHeight()<<" rows x "<<termWidth()<<" columns\n";
@@ -717,6 +739,8 @@ int StateMachine::run() {
 		state->act();
 	}
 	UserOptions::getInstance().writeFile();
+	if (!gc.waitForSave())	// a save may still be on its way to disk
+		return 1;
 	return 0;
 }
 
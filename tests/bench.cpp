@@ -0,0 +1,291 @@
+// BENCH.CPP
+// throughput benchmarks for the Goals application
+// usage: benchgoals [number of goal records] [threads]
+// Copyright 2018 Thanasis Karpetis
+//
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chrono>
+#include <string>
+#include <sstream>
+#include <cstdio>
+#include <sys/stat.h>
+#include "goals.h"
+#include "scanner.h"
+#include "threadpool.h"
+
+namespace {
+
+const char* benchFile="benchgoals.xml";
+
+// seconds spent in f
+template <class F>
+double timeIt( F f ) {
+	auto start=std::chrono::steady_clock::now();
+	f();
+	std::chrono::duration<double> elapsed=std::chrono::steady_clock::now()-start;
+	return elapsed.count();
+}
+
+// write a goals file of the given number of distinct records, returns its size in bytes
+size_t makeGoalFile( const std::string& name, int records ) {
+	std::ofstream out{name};
+	out<<"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<goalkeeper>  <!-- benchmark data -->\n";
+	for (int i=0;i<records;i++) {
+		out<<"\t<goal>\n\t\t<name>Benchmark goal number "<<i<<" with a longish description</name>\n";
+		out<<"\t\t<priority>"<<(i*37)%101<<"</priority>\n";
+		out<<"\t\t<completion>"<<(i*53)%101<<"</completion>\n";
+		out<<"\t\t<unitcost>"<<(i%1000)/100.<<"</unitcost>\n\t</goal>\n";
+	}
+	out<<"</goalkeeper>\n";
+	out.close();
+	struct stat st;
+	stat(name.c_str(),&st);
+	return st.st_size;
+}
+
+// parse every record of the file without storing it
+template <class Parser>
+int parseAll( Parser& parser ) {
+	GoalContainer gc;
+	int count=0;
+	parser.getHeader();
+	std::string root{parser.getLabel()};
+	std::string endLabel="/"+root;
+	auto label=parser.getLabel();
+	while (label!=endLabel && parser.moreToGo()) {
+		std::string goalLabel{label};
+		gc.readGoal(parser,goalLabel);
+		count++;
+		label=parser.getLabel();
+	}
+	return count;
+}
+
+void report( const char* what, size_t bytes, double seconds ) {
+	printf("%-32s %8.3f s %10.1f MB/s\n",what,seconds,bytes/seconds/1e6);
+}
+
+void reportRate( const char* what, size_t records, double seconds ) {
+	printf("%-32s %8.3f s %10.1f Mrec/s\n",what,seconds,records/seconds/1e6);
+}
+
+void benchParse( size_t bytes ) {
+	printf("--- parsing %.1f MB ---\n",bytes/1e6);
+	report("stream XMLParser",bytes,timeIt([]{
+		XMLParser parser{benchFile};
+		parseAll(parser);
+	}));
+	const char* names[]={"MappedXMLParser scalar","MappedXMLParser SSE2","MappedXMLParser AVX2"};
+	ScanLevel best=bestScanLevel();
+	for (int lvl=SCAN_SCALAR;lvl<=best;lvl++) {
+		setScanLevel(static_cast<ScanLevel>(lvl));
+		report(names[lvl],bytes,timeIt([]{
+			MappedXMLParser parser{benchFile};
+			parseAll(parser);
+		}));
+	}
+	setScanLevel(best);
+}
+
+void benchLoad( size_t bytes ) {
+	printf("--- GoalContainer::loadFile, %u threads available ---\n",ThreadPool::getInstance().size());
+	report("serial load",bytes,timeIt([]{
+		GoalContainer gc;
+		gc.setParallelLoading(false);
+		gc.loadFile(benchFile);
+	}));
+	report("sharded load",bytes,timeIt([]{
+		GoalContainer gc;
+		gc.loadFile(benchFile);
+	}));
+}
+
+void benchSnapshot( size_t bytes ) {
+	printf("--- startup from the binary snapshot ---\n");
+	{
+		GoalContainer gc;
+		gc.loadFile(benchFile);
+		gc.insertGoal(Goal{"forces a save",1,1,1.});
+		gc.foldJournal();
+	}
+	report("xml load",bytes,timeIt([]{
+		GoalContainer gc;
+		gc.setSnapshots(false);
+		gc.loadFile(benchFile);
+	}));
+	report("snapshot load",bytes,timeIt([]{
+		GoalContainer gc;
+		gc.loadFile(benchFile);
+	}));
+}
+
+void benchSave( size_t bytes ) {
+	printf("--- GoalContainer::saveFile ---\n");
+	GoalContainer gc;
+	gc.setSnapshots(false);
+	gc.loadFile(benchFile);
+	report("buffered xml save",bytes,timeIt([&]{
+		gc.foldJournal();
+	}));
+	report("journaled save of one edit",bytes,timeIt([&]{
+		gc.insertGoal(Goal{"journaled edit",1,1,1.});
+		gc.saveFile();
+	}));
+	// what the main loop waits for when the save worker does the writing. without a journal
+	// every save is a full rewrite
+	GoalContainer unjournaled;
+	unjournaled.setSnapshots(false);
+	unjournaled.setJournaling(false);
+	unjournaled.loadFile(benchFile);
+	double waited=timeIt([&]{
+		unjournaled.insertGoal(Goal{"background edit",1,1,1.});
+		unjournaled.saveInBackground();
+	});
+	unjournaled.waitForSave();
+	report("background save, caller's share",bytes,waited);
+}
+
+// filtering and sorting the loaded records, which is what the main loop does after every change
+void benchQuery() {
+	GoalContainer gc;
+	gc.loadFile(benchFile);
+	size_t records=gc.activesize();
+	printf("--- searchGoals and sortGoals over %zu records ---\n",records);
+	UserOptions &options=UserOptions::getInstance();
+	reportRate("filter priority",records,timeIt([&]{
+		options.setSearchCriteria(SearchCriteria{Goal{"",50,-1,-1.}});
+		gc.searchGoals();
+	}));
+	reportRate("filter completion and cost",records,timeIt([&]{
+		options.setSearchCriteria(SearchCriteria{Goal{"",-1,10,1.5}});
+		gc.searchGoals();
+	}));
+	reportRate("filter cost, index ready",records,timeIt([&]{
+		options.setSearchCriteria(SearchCriteria{Goal{"",-1,-1,2.5}});
+		gc.searchGoals();
+	}));
+	SearchCriteria ranges;
+	ranges.minPriority=90;
+	reportRate("filter priority >= 90",records,timeIt([&]{
+		options.setSearchCriteria(ranges);
+		gc.searchGoals();
+	}));
+	ranges=SearchCriteria{};
+	ranges.minCost=2.;
+	ranges.maxCost=2.1;
+	reportRate("filter cost 2.0-2.1",records,timeIt([&]{
+		options.setSearchCriteria(ranges);
+		gc.searchGoals();
+	}));
+	ranges.maxPriority=10;
+	reportRate("filter cost and priority <= 10",records,timeIt([&]{
+		options.setSearchCriteria(ranges);
+		gc.searchGoals();
+	}));
+	reportRate("filter name, builds trigrams",records,timeIt([&]{
+		options.setSearchCriteria(SearchCriteria{Goal{"number 12345",-1,-1,-1.}});
+		gc.searchGoals();
+	}));
+	reportRate("filter name, literal",records,timeIt([&]{
+		options.setSearchCriteria(SearchCriteria{Goal{"number 54321",-1,-1,-1.}});
+		gc.searchGoals();
+	}));
+	reportRate("filter name, prefix",records,timeIt([&]{
+		options.setSearchCriteria(SearchCriteria{Goal{"^Benchmark goal number 9",-1,-1,-1.}});
+		gc.searchGoals();
+	}));
+	reportRate("filter name, regex",records,timeIt([&]{
+		options.setSearchCriteria(SearchCriteria{Goal{"number 1[0-9]*7 with",-1,-1,-1.}});
+		gc.searchGoals();
+	}));
+	gc.setTrigramIndex(false);
+	reportRate("filter name, no trigram index",records,timeIt([&]{
+		options.setSearchCriteria(SearchCriteria{Goal{"number 12345",-1,-1,-1.}});
+		gc.searchGoals();
+	}));
+	gc.setTrigramIndex(true);
+	options.setSearchCriteria(SearchCriteria{});
+	gc.searchGoals();
+	gc.sortGoals();
+	reportRate("sort priority, completion",records,timeIt([&]{
+		options.setSortPrefs("pdca");
+		gc.sortGoals();
+	}));
+	reportRate("sort unit cost",records,timeIt([&]{
+		options.setSortPrefs("ua");
+		gc.sortGoals();
+	}));
+	reportRate("sort name, priority",records,timeIt([&]{
+		options.setSortPrefs("napd");
+		gc.sortGoals();
+	}));
+	// what the first screen after a new sort order costs with paging on
+	options.setPaging(true);
+	reportRate("first page, name, priority",records,timeIt([&]{
+		options.setSortPrefs("ndpa");
+		gc.sortGoals();
+		std::ostringstream page;
+		gc.printAll(page,0,40);
+	}));
+	options.setPaging(false);
+	reportRate("sort back to a recent order",records,timeIt([&]{
+		options.setSortPrefs("pdca");
+		gc.sortGoals();
+	}));
+	{
+		SearchCriteria criteria;
+		criteria.maxPriority=19;	// about a fifth of the records
+		options.setSearchCriteria(criteria);
+		options.setShowNum(true);
+		gc.searchGoals();
+		gc.sortGoals();
+		std::ostringstream listing;
+		reportRate("list results, numbered",gc.searchsize(),timeIt([&]{
+			listing.str("");
+			gc.printAll(listing,0,1<<30);
+		}));
+		options.setShowNum(false);
+		options.setSearchCriteria(SearchCriteria{});
+		gc.searchGoals();
+		gc.sortGoals();
+	}
+	// what one edit at the prompt costs once the view is sorted
+	const int edits=100;
+	double editing=timeIt([&]{
+		for (int i=0;i<edits;i++) {
+			gc.insertGoal(Goal{"inserted while sorted "+std::to_string(i),i%101,50,1.});
+			gc.searchGoals();
+			gc.sortGoals();
+			Goal goal;
+			gc.getGoalByRecordID(i,goal);
+			goal.priority=(goal.priority+50)%101;
+			gc.modifyRecord(i,goal);
+			gc.searchGoals();
+			gc.sortGoals();
+		}
+	});
+	printf("%-32s %8.3f ms\n","insert and modify, each",editing/(2*edits)*1e3);
+	options.setSortPrefs("");
+}
+
+} // namespace
+
+int main( int argc, char** argv ) {
+	int records= (argc>1? std::stoi(argv[1]) : 500000);
+	ThreadPool::getInstance().resize(argc>2? std::stoi(argv[2]) : 0);
+	size_t bytes=makeGoalFile(benchFile,records);
+
+	benchParse(bytes);
+	benchLoad(bytes);
+	benchSnapshot(bytes);
+	benchSave(bytes);
+	benchQuery();
+
+	std::remove(benchFile);
+	std::remove((std::string{benchFile}+".bin").c_str());
+	std::remove((std::string{benchFile}+".bak").c_str());
+	std::remove((std::string{benchFile}+".journal").c_str());
+	return 0;
+}
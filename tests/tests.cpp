@@ -12,6 +12,35 @@
 #include <string>
 #include "goals.h"
 #include "statemachine.h"
+#include "scanner.h"
+#include "threadpool.h"
+#include "journal.h"
+#include "radixsort.h"
+#include "parallelsort.h"
+#include <atomic>
+#include <cstdlib>
+#include <glob.h>
+
+// global allocation counter, used to prove parts of the loader do not allocate
+std::atomic<long> allocations{0};
+
+// every replacement below goes through this matched pair. they are kept out of line: once
+// free() is inlined into a delete whose pointer came from the library's own operator new,
+// gcc -O2 reports a -Wmismatched-new-delete it cannot tell is a false positive
+__attribute__((noinline)) void* allocateBlock( size_t size ) {
+	allocations++;
+	if (void* p=std::malloc(size?size:1))
+		return p;
+	throw std::bad_alloc();
+}
+__attribute__((noinline)) void releaseBlock( void* p ) noexcept { std::free(p); }
+
+void* operator new( size_t size ) { return allocateBlock(size); }
+void* operator new[]( size_t size ) { return allocateBlock(size); }
+void operator delete( void* p ) noexcept { releaseBlock(p); }
+void operator delete( void* p, size_t ) noexcept { releaseBlock(p); }
+void operator delete[]( void* p ) noexcept { releaseBlock(p); }
+void operator delete[]( void* p, size_t ) noexcept { releaseBlock(p); }
 
 TEST(goal,create) {
 	try {
@@ -56,13 +85,130 @@ TEST( XMLParser, absorbComment_implicit ) {
 	std::string label=parser.getLabel(); // should have ignored the comment and leading w/space
 	ASSERT_EQ(label,"goal");
 }
+// helper for parser tests: dump a string into a scratch file
+void writeTextFile( const std::string& name, const std::string& content ) {
+	std::ofstream out{name};
+	out<<content;
+}
+
+//test MappedXMLParser against the stream parser on the sample file
+TEST( MappedXMLParser, labelsAndData ) {
+	MappedXMLParser parser{"goalsample.xml"};
+	ASSERT_EQ(parser.getHeader(),"xml version=\"1.0\" encoding=\"UTF-8\"");
+	ASSERT_EQ(parser.getLabel(),"goalkeeper");
+	ASSERT_EQ(parser.getLabel(),"goal");// comment in between is absorbed
+	ASSERT_EQ(parser.getLabel(),"name");
+	ASSERT_EQ(parser.getLeafData(),"Sample goal");
+	ASSERT_EQ(parser.getLabel(),"/name");
+}
+
+// both parser backends must raise the same errors on malformed input
+TEST( MappedXMLParser, sameErrors ) {
+	std::vector<std::string> bad{
+		"",
+		"<?xml?>\n",
+		"<?xml version=\"1.0\"?>\n<goalkeeper>\n\t<goal\n",
+		"<?xml version=\"1.0\"?>\n<goalkeeper>> <goal>",
+		"<?xml version=\"1.0\"?>\n<goalkeeper><!-- unterminated",
+		"<?xml version=\"1.0\"?>\n<goalkeeper><go al>",
+		"<?xml version=\"1.0\"?>\n<goalkeeper><goal><name>bad>data</name>",
+		"<?xml version=\"1.0\"?>\n<goalkeeper><goal><name>no end"
+	};
+	for (auto &content:bad) {
+		writeTextFile("malformed.xml",content);
+		std::string streamError, mappedError;
+		try {
+			XMLParser parser{"malformed.xml"};
+			parser.getHeader();
+			for (int i=0;i<3;i++) parser.getLabel();
+			parser.getLabel();
+			parser.getLeafData();
+		} catch (std::exception &e) { streamError=e.what(); }
+		try {
+			MappedXMLParser parser{"malformed.xml"};
+			parser.getHeader();
+			for (int i=0;i<3;i++) parser.getLabel();
+			parser.getLabel();
+			parser.getLeafData();
+		} catch (std::exception &e) { mappedError=e.what(); }
+		ASSERT_FALSE(streamError.empty());
+		ASSERT_EQ(streamError,mappedError);
+	}
+}
+
+// every scanner implementation finds the same delimiters, including in the scalar tails
+TEST( Scanner, levelsAgree ) {
+	std::string text;
+	for (int i=0;i<300;i++)
+		text+=std::string(i%41,'x')+(i%3?"<a>":"\t-\n>")+(i%7?"":"->");
+	const char* first=text.data();
+	const char* last=first+text.size();
+	std::vector<const char*> anyRef, digraphRef;
+	setScanLevel(SCAN_SCALAR);
+	for (const char* p=first; p<last; p++) {
+		anyRef.push_back(scanAny(p,last,"<>\t\n ",5));
+		digraphRef.push_back(scanDigraph(p,last,'-','>'));
+	}
+	for (int lvl=SCAN_SSE2; lvl<=bestScanLevel(); lvl++) {
+		setScanLevel(static_cast<ScanLevel>(lvl));
+		for (const char* p=first; p<last; p++) {
+			ASSERT_EQ(scanAny(p,last,"<>\t\n ",5),anyRef[p-first]);
+			ASSERT_EQ(scanDigraph(p,last,'-','>'),digraphRef[p-first]);
+		}
+	}
+	setScanLevel(bestScanLevel());
+}
+
+// compiled name filters, literal or not, agree with std::regex on every scanner implementation
+TEST( NameMatcher, agreesWithRegex ) {
+	std::vector<std::string> names{"", "a", "c++ goal", "learn c++ and more", "goal.txt",
+		"a much longer goal name that crosses a vector block boundary, twice over: c++$",
+		"ends with a dollar$", "GOAL", "goal"};
+	for (int i=0;i<40;i++)
+		names.push_back(std::string(i,'x')+"needle"+std::string(i%5,'y'));
+	std::vector<std::string> patterns{"goal", "^goal", "goal$", "^goal$", "c\\+\\+", "\\.txt$",
+		"needle", "needley", "^x*needle", "dollar\\$$", "g.al", "needle|GOAL", "xx?needle",
+		"[A-Z]+", "\\w+ goal", "^$", "$", "^"};
+	for (int lvl=SCAN_SCALAR; lvl<=bestScanLevel(); lvl++) {
+		setScanLevel(static_cast<ScanLevel>(lvl));
+		for (auto &pattern:patterns) {
+			NameMatcher matcher{pattern};
+			std::regex re{pattern};
+			for (auto &name:names)
+				ASSERT_EQ(matcher.matches(name),std::regex_search(name,re)) <<pattern<<" on "<<name;
+		}
+	}
+	setScanLevel(bestScanLevel());
+	ASSERT_FALSE(NameMatcher{"^plain words$"}.isRegex());
+	ASSERT_TRUE(NameMatcher{"g.al"}.isRegex());
+	NameMatcher invalid{"list[1"};	// std::regex rejects it, the text is searched for as typed
+	ASSERT_TRUE(invalid.matches("print list[1]"));
+	ASSERT_FALSE(invalid.matches("print list1"));
+}
+
+// the options are a singleton shared by every test: each test that reads them starts from the
+// defaults, whatever order the tests run in
+void resetOptions() {
+	UserOptions &options=UserOptions::getInstance();
+	options.setSortPrefs("");
+	options.setSearchCriteria(SearchCriteria{});
+	options.setPaging(false);
+	options.setShowNum(false);
+	options.setAutosave(0);
+	options.setParallelSearchMin(1<<16);
+	options.setParallelSortMin(1<<17);
+	options.setSortCacheMB(64);
+}
+
 // test creation of emplty container
 TEST( GoalContainer, createEmpty ) {
+	resetOptions();
 	GoalContainer gc;
 	ASSERT_EQ(gc.size(),0);
 }
 // test reading a single goal entry
 TEST( GoalContainer, readGoal ) {
+	resetOptions();
 	GoalContainer gc;
 	XMLParser parser{"goalsample.xml"};
 	parser.getHeader();
@@ -74,8 +220,131 @@ TEST( GoalContainer, readGoal ) {
 	std::string str("                             Sample goal      100          50       0.01\n");
 	ASSERT_EQ(out.str(),str);
 }
+// decoding a goal record through the mapped parser allocates nothing but a long name
+TEST( GoalContainer, readGoalAllocations ) {
+	resetOptions();
+	std::string text="<?xml version=\"1.0\"?>\n<goalkeeper>\n";
+	for (int i=0;i<100;i++) {
+		text+="<goal><name>"+std::string(i%2?"short":"a name too long for the short string buffer");
+		text+="</name><priority>+42</priority>\n<completion> 7</completion><unitcost>0.25</unitcost></goal>\n";
+	}
+	GoalContainer gc;
+	MappedXMLParser parser{text.data(),text.data()+text.size()};
+	parser.getHeader();
+	parser.getLabel();
+	long before=allocations;
+	Goal goal;
+	for (int i=0;i<100;i++) {
+		goal=gc.readGoal(parser,parser.getLabel());
+		ASSERT_EQ(goal.priority,42);
+		ASSERT_EQ(goal.completion,7);
+		ASSERT_EQ(goal.unitcost,0.25);
+	}
+	ASSERT_EQ(allocations-before,50);// one per long name, none for the rest of the record
+}
+
+//malformed numbers are reported with their label
+TEST( GoalContainer, readGoalBadNumber ) {
+	resetOptions();
+	std::string text="<?xml version=\"1.0\"?>\n<goalkeeper><goal><name>x</name><priority>high</priority></goal>";
+	GoalContainer gc;
+	MappedXMLParser parser{text.data(),text.data()+text.size()};
+	parser.getHeader();
+	parser.getLabel();
+	try {
+		gc.readGoal(parser,parser.getLabel());
+		FAIL();
+	} catch (std::runtime_error &e) {
+		ASSERT_EQ(std::string{e.what()},"priority: invalid number [high]");
+	}
+}
+
+//priority and completion are stored in a byte, values outside 0-100 are refused
+TEST( GoalContainer, percentRange ) {
+	resetOptions();
+	std::string text="<?xml version=\"1.0\"?>\n<goalkeeper><goal><name>x</name><completion>101</completion></goal>";
+	GoalContainer gc;
+	MappedXMLParser parser{text.data(),text.data()+text.size()};
+	parser.getHeader();
+	parser.getLabel();
+	ASSERT_EQ(gc.readGoal(parser,parser.getLabel()).completion,100);
+
+	// a record out of range in a file is kept, and so is everything after it
+	writeTextFile("indexsample.xml","<?xml version=\"1.0\"?>\n<goalkeeper>"
+		"<goal><name>a</name><priority>1</priority></goal>"
+		"<goal><name>b</name><priority>150</priority><completion>-3</completion></goal>"
+		"<goal><name>c</name><priority>3</priority></goal></goalkeeper>");
+	gc.setJournaling(false);
+	gc.setSnapshots(false);
+	for (bool mapped:{true,false}) {
+		gc.setMappedParsing(mapped);
+		gc.loadFile("indexsample.xml");
+		ASSERT_EQ(gc.size(),3);
+		Goal b;
+		gc.getGoalByRecordID(1,b);
+		ASSERT_EQ(b,(Goal{"b",100,0,0.}));
+	}
+
+	gc.insertGoal(Goal{"too urgent",255,0,1.});	// stored as the nearest value it can hold
+	ASSERT_EQ(gc.findNameIndex("too urgent"),3);
+	gc.insertGoal(Goal{"in range",100,0,1.});
+	gc.sortGoals();
+	ASSERT_FALSE(gc.modifyRecord(4,Goal{"in range",100,-1,1.}));	// the editor's values are checked
+	Goal copy;
+	gc.getGoalByRecordID(4,copy);
+	ASSERT_EQ(copy,(Goal{"in range",100,0,1.}));
+	gc.getGoalByRecordID(3,copy);
+	ASSERT_EQ(copy,(Goal{"too urgent",100,0,1.}));
+}
+
+// set operations and ordered iteration across word boundaries
+TEST( DynamicBitset, members ) {
+	DynamicBitset a, b(130);
+	for (int i=0;i<130;i++)
+		a.push_back(i%3==0);
+	for (int i:{0,3,64,65,129})
+		b.set(i);
+	ASSERT_EQ(a.size(),130);
+	ASSERT_EQ(a.count(),44);
+	ASSERT_TRUE(a.test(129) && !a.test(128));
+	a&=b;
+	std::vector<int> members;
+	a.forEach([&]( int i ) { members.push_back(i); });
+	ASSERT_EQ(members,(std::vector<int>{0,3,129}));
+	a.reset(129);
+	a.resize(70);	// shrinking clears the bits cut off, growing adds clear ones
+	a.resize(140);
+	ASSERT_EQ(a.count(),2);
+	a.reset();
+	ASSERT_FALSE(a.any());
+}
+
+// lookups stay correct through growth and backward-shift deletion
+TEST( NameIndex, insertFindErase ) {
+	NameArena arena;
+	std::vector<std::string_view> keys;
+	NameIndex index{keys};
+	for (int i=0;i<5000;i++) {
+		keys.push_back(arena.add("name "+std::to_string(i)));
+		ASSERT_TRUE(index.insert(keys.back(),i));
+	}
+	ASSERT_FALSE(index.insert("name 42",5000));	// duplicates are refused
+	for (int i=0;i<5000;i+=2)
+		index.erase(keys[i]);
+	ASSERT_EQ(index.size(),2500);
+	for (int i=0;i<5000;i++)
+		ASSERT_EQ(index.find("name "+std::to_string(i)), (i%2)? i : -1);
+	ASSERT_EQ(index.find("name 5000"),-1);
+	size_t bytes=0;
+	for (auto key:keys)
+		bytes+=key.size();
+	ASSERT_EQ(arena.used(),bytes);	// every name stored once, at a stable address
+	ASSERT_EQ(keys[0],"name 0");
+}
+
 //test trying to read from a nonexistent or unreadable file
 TEST( GoalContainer, readNonOpenableFile ) {
+	resetOptions();
 	GoalContainer gc;
 	gc.loadFile("NONEXISTENT");
 	ASSERT_EQ(gc.size(),0);
@@ -83,6 +352,7 @@ TEST( GoalContainer, readNonOpenableFile ) {
 
 //test importing goals from xml file
 TEST( GoalContainer, openfile ) {
+	resetOptions();
 	GoalContainer gc;
 	gc.loadFile("goalsample.xml");//read records from the sample xml file
 	ASSERT_EQ(gc.size(),3); // also testing for rejetion of duplicate goals included in input file
@@ -93,8 +363,94 @@ TEST( GoalContainer, openfile ) {
 			"                  Pass All tests at 100%      100         100       0.01\n"	);
 }
 
+//both parser backends load the same goals
+TEST( GoalContainer, mappedLoadMatchesStream ) {
+	resetOptions();
+	GoalContainer streamed, mapped;
+	streamed.setMappedParsing(false);
+	streamed.loadFile("goalsample.xml");
+	mapped.loadFile("goalsample.xml");
+	std::ostringstream out1, out2;
+	streamed.printAll(out1);
+	mapped.printAll(out2);
+	ASSERT_EQ(streamed.size(),mapped.size());
+	ASSERT_EQ(out1.str(),out2.str());
+}
+
+// helper: a goals file with repeated names and comments, large enough to be cut into shards
+std::string makeGoalText( int records ) {
+	std::ostringstream out;
+	out<<"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<goalkeeper>  <!-- generated -->\n";
+	for (int i=0;i<records;i++) {
+		out<<"\t<goal>\n\t\t<name>goal "<<i%(records-records/5)<<"</name>\n";// last fifth repeats names
+		out<<"\t\t<priority>"<<i%101<<"</priority> <!-- range is 0 to 100 -->\n";
+		out<<"\t\t<completion>"<<(i*7)%101<<"</completion>\n";
+		out<<"\t\t<unitcost>"<<i%13+0.5<<"</unitcost>\n\t</goal>\n";
+	}
+	out<<"</goalkeeper>\n";
+	return out.str();
+}
+
+// print a container's records in file order
+std::string dumpGoals( GoalContainer &gc ) {
+	std::ostringstream out;
+	gc.printAll(out,0,1<<30);
+	return out.str();
+}
+
+// the page renderer lines rows up exactly like Goal::print() on a stream, numbers included
+TEST( GoalContainer, printAllFormat ) {
+	resetOptions();	// file order, nothing filtered out
+	GoalContainer gc;
+	gc.setJournaling(false);
+	std::vector<Goal> goals{{"short",0,100,2.5},{"a name well over the forty columns of its field",100,0,1e-7},
+		{"costly",55,5,123456789.},{"precise",7,77,0.1234567},{"negative",1,1,-3.},{"zero",2,2,0.}};
+	for (auto &goal:goals)
+		gc.insertGoal(goal);
+	gc.searchGoals();
+	gc.sortGoals();
+	UserOptions &options=UserOptions::getInstance();
+	for (bool numbers:{false,true}) {
+		options.setShowNum(numbers);
+		std::ostringstream expected, out;
+		for (size_t i=1;i<5;i++) {
+			if (numbers)
+				expected<<std::setfill(' ')<<std::setw(4)<<i+1<<".";
+			goals[i].print(expected);
+		}
+		ASSERT_EQ(gc.printAll(out,1,4),5);
+		ASSERT_EQ(out.str(),expected.str());
+	}
+	options.setShowNum(false);
+}
+
+//sharded loading must produce the same records, in the same order, as the serial one
+TEST( GoalContainer, parallelLoadMatchesSerial ) {
+	resetOptions();
+	ThreadPool::getInstance().resize(4);
+	writeTextFile("shardsample.xml",makeGoalText(1000));
+	GoalContainer serial, sharded;
+	serial.setParallelLoading(false);
+	serial.loadFile("shardsample.xml");
+	sharded.setParallelLoadMin(0);
+	sharded.loadFile("shardsample.xml");
+	ASSERT_EQ(serial.size(),800);
+	ASSERT_EQ(sharded.size(),serial.size());
+	ASSERT_EQ(dumpGoals(sharded),dumpGoals(serial));
+
+	// a truncated file keeps the records read before the error, just like the serial parser
+	std::string text=makeGoalText(1000);
+	writeTextFile("shardsample.xml",text.substr(0,text.size()*2/3));
+	serial.loadFile("shardsample.xml");
+	sharded.loadFile("shardsample.xml");
+	ASSERT_EQ(sharded.size(),serial.size());
+	ASSERT_EQ(dumpGoals(sharded),dumpGoals(serial));
+	ThreadPool::getInstance().resize(0);
+}
+
 // test acceptance of sort strings, valid or not
 TEST( GoalContainer, validateString ) {
+	resetOptions();
 	GoalContainer gc;
 	ASSERT_EQ( UserOptions::getInstance().validateString(""),true);		//valid, empty sorting options
 	ASSERT_EQ( UserOptions::getInstance().validateString("na"),true);	//valid, name ascending
@@ -130,8 +486,15 @@ class GoalTester{
 	std::string getFilename() { return gc->filename;}
 	void setFilename( const std::string& newname ) { gc->filename=newname;}//no error checking
 
-	std::vector<Goal>* getGoalVector() { return &gc->v;}
+	std::vector<Goal> getGoalVector() { // the records, materialized from their columns
+		std::vector<Goal> goals;
+		for (size_t i=0;i<gc->v.size();i++)
+			goals.push_back(gc->v[i]);
+		return goals;
+	}
 	std::vector<int>* getSortedVector() { return &gc->sorted;}
+	size_t getSortedPrefix() { return gc->sortedPrefix;}
+	size_t getCachedOrders() { return gc->sortCache.size();}
 	
 	bool isModified() { return gc->isModified();}
 	size_t getSize() {return gc->size();}
@@ -142,6 +505,7 @@ class GoalTester{
 //----------------------------------------------------------------------------------
 // ensure saving after reading a file preserves content and order
 TEST( GoalContainer, saveFile ) {
+	resetOptions();
 	GoalContainer gc;
 	GoalTester tester(&gc);
 
@@ -155,18 +519,687 @@ TEST( GoalContainer, saveFile ) {
 	GoalTester tester2(&gc2);
 	tester2.loadFile("goalSaved.xml"); // both gc's use the same UserOptions
 
-	std::vector<Goal> *v1, *v2;
-	v1=tester.getGoalVector();
-	v2=tester2.getGoalVector();
+	std::vector<Goal> v1=tester.getGoalVector();
+	std::vector<Goal> v2=tester2.getGoalVector();
 
-	ASSERT_EQ(v1->size(),v2->size());
+	ASSERT_EQ(v1.size(),v2.size());
 
-	for (int i=0;i<v1->size();i++)
-		ASSERT_EQ((*v1)[i], (*v2)[i]);
-	v1=nullptr;
-	v2=nullptr;
+	for (size_t i=0;i<v1.size();i++)
+		ASSERT_EQ(v1[i], v2[i]);
 
 }
+// the binary snapshot written by saveFile is used while current and ignored once the xml changes
+TEST( GoalContainer, snapshot ) {
+	resetOptions();
+	GoalContainer gc;
+	GoalTester tester(&gc);
+	writeTextFile("snapshotsample.xml",makeGoalText(100));
+	std::remove("snapshotsample.xml.bin");
+	tester.loadFile("snapshotsample.xml");
+	tester.setModified(true);
+	ASSERT_TRUE(tester.saveFile());
+
+	std::ifstream bin{"snapshotsample.xml.bin"};
+	ASSERT_TRUE(bin.good());
+	GoalContainer fromSnapshot, fromXML;
+	fromXML.setSnapshots(false);
+	fromSnapshot.loadFile("snapshotsample.xml");
+	fromXML.loadFile("snapshotsample.xml");
+	ASSERT_EQ(fromSnapshot.size(),80);
+	ASSERT_EQ(dumpGoals(fromSnapshot),dumpGoals(fromXML));
+
+	writeTextFile("snapshotsample.xml",makeGoalText(10));// newer xml, snapshot is stale
+	fromSnapshot.loadFile("snapshotsample.xml");
+	ASSERT_EQ(fromSnapshot.size(),8);
+
+	// the backup of a same-size file moved back is older than the snapshot, which must not be used
+	gc.setJournaling(false);	// so saving rewrites the file, keeping a .bak
+	tester.loadFile("snapshotsample.xml");
+	tester.setModified(true);
+	ASSERT_TRUE(tester.saveFile());	// in the writer's own layout
+	gc.sortGoals();
+	Goal goal;
+	ASSERT_GE(gc.getGoalByRecordID(5,goal),0);
+	goal.priority= goal.priority==5? 6 : 5;	// one digit either way
+	ASSERT_TRUE(gc.modifyRecord(5,goal));
+	ASSERT_TRUE(tester.saveFile());
+	ASSERT_EQ(std::ifstream("snapshotsample.xml.bak",std::ios::ate).tellg(),
+		std::ifstream("snapshotsample.xml",std::ios::ate).tellg());
+	ASSERT_EQ(std::rename("snapshotsample.xml.bak","snapshotsample.xml"),0);
+	GoalContainer afterRestore;
+	afterRestore.setJournaling(false);
+	afterRestore.loadFile("snapshotsample.xml");
+	fromXML.loadFile("snapshotsample.xml");
+	ASSERT_EQ(dumpGoals(afterRestore),dumpGoals(fromXML));
+}
+
+// the buffered writer's output, including its fixed-point numbers, matches the old iostream/sprintf one
+TEST( XMLWriter, bufferedOutput ) {
+	resetOptions();
+	GoalContainer gc;
+	{
+		XMLWriter writer{"writersample.xml"};
+		writer.writeHeader();
+		writer.openLabel("goalkeeper",true);
+		gc.writeGoal(writer,Goal{"Sample goal",100,50,0.125});
+		writer.closeLabel();
+		writer.flush();
+	}
+	std::ifstream in{"writersample.xml"};
+	std::stringstream content;
+	content<<in.rdbuf();
+	ASSERT_EQ(content.str(),"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<goalkeeper>\n\t<goal>\n"
+		"\t\t<name>Sample goal</name>\n\t\t<priority>100</priority>\n\t\t<completion>50</completion>\n"
+		"\t\t<unitcost>0.12</unitcost>\n\t</goal>\n</goalkeeper>\n");
+
+	for (double value:{0.,0.005,0.015,1.005,2.675,99.999,12345.678,1e-9,-3.14159}) {
+		char expected[64];
+		snprintf(expected,sizeof(expected),"%.2lf",value);
+		XMLWriter writer{"writersample.xml"};
+		writer.writeLeaf("u",value,2);
+		writer.flush();
+		std::ifstream in{"writersample.xml"};
+		std::string line;
+		std::getline(in,line);
+		ASSERT_EQ(line,std::string{"<u>"}+expected+"</u>");
+	}
+}
+
+// helper: whole contents of a file
+std::string readTextFile( const std::string& name ) {
+	std::ifstream in{name};
+	std::stringstream content;
+	content<<in.rdbuf();
+	return content.str();
+}
+
+// replacing a file keeps the previous version as .bak and leaves no temporary files behind
+TEST( atomicReplace, backupAndRename ) {
+	std::remove("atomicsample.xml");
+	std::remove("atomicsample.xml.bak");
+	atomicReplace("atomicsample.xml","first",true);
+	ASSERT_EQ(readTextFile("atomicsample.xml"),"first");
+	std::ifstream noBackup{"atomicsample.xml.bak"};
+	ASSERT_FALSE(noBackup.good());// nothing existed to back up
+
+	atomicReplace("atomicsample.xml","second",true);
+	atomicReplace("atomicsample.xml","third",true);
+	ASSERT_EQ(readTextFile("atomicsample.xml"),"third");
+	ASSERT_EQ(readTextFile("atomicsample.xml.bak"),"second");
+
+	glob_t leftovers;
+	ASSERT_EQ(glob("atomicsample.xml*.tmp*",0,nullptr,&leftovers),GLOB_NOMATCH);
+
+	ASSERT_THROW(atomicReplace("nonexistent_dir/atomicsample.xml","data"),std::runtime_error);
+}
+
+// edits are journaled as they happen and replayed on the next load, even without saving
+TEST( GoalContainer, journal ) {
+	resetOptions();
+	std::string text=makeGoalText(100);
+	writeTextFile("journalsample.xml",text);
+	std::remove("journalsample.xml.journal");
+	std::remove("journalsample.xml.bin");
+	{
+		GoalContainer gc;
+		gc.loadFile("journalsample.xml");
+		gc.insertGoal(Goal{"journaled goal",5,6,7.5});
+		gc.deleteRecord(0);		// "goal 0"
+		gc.modifyRecord(0,Goal{"renamed goal",1,2,3.});// "goal 1"
+		ASSERT_EQ(readTextFile("journalsample.xml"),text);// the goals file itself is untouched
+		// no save: simulates a crash before exit
+	}
+	GoalContainer recovered;
+	recovered.loadFile("journalsample.xml");
+	ASSERT_EQ(recovered.activesize(),80);
+	ASSERT_EQ(recovered.findNameIndex("goal 0"),-1);
+	ASSERT_EQ(recovered.findNameIndex("goal 1"),-1);
+	ASSERT_TRUE(recovered.findNameIndex("renamed goal")>=0);
+	ASSERT_TRUE(recovered.findNameIndex("journaled goal")>=0);
+
+	// a few edits are saved by the journal alone, discarded ones are rolled back
+	ASSERT_TRUE(recovered.saveFile());
+	recovered.insertGoal(Goal{"kept goal",5,6,7.5});
+	ASSERT_TRUE(recovered.saveFile());
+	ASSERT_EQ(readTextFile("journalsample.xml"),text);
+	recovered.insertGoal(Goal{"discarded goal",5,6,7.5});
+	recovered.discardChanges();
+
+	// a torn or garbled entry at the end of the journal is ignored: a complete frame whose checksum
+	// fails, and a frame whose length runs past the end of the file. Both carry the deletion of
+	// "kept goal", which must not happen
+	GoalContainer reloaded;
+	const char* frames[]={"\x0e\0\0\0\0\0\0\0\x03\x09\0\0\0kept goal",	// length 14, checksum 0
+		"\x20\0\0\0\0\0\0\0\x03\x09\0\0\0kept goal"};		// length 32, 14 bytes follow
+	for (const char* frame:frames) {
+		std::ofstream{"journalsample.xml.journal",std::ios::app|std::ios::binary}.write(frame,22);
+		reloaded.loadFile("journalsample.xml");
+		ASSERT_EQ(reloaded.activesize(),81);
+		ASSERT_TRUE(reloaded.findNameIndex("kept goal")>=0);
+		ASSERT_EQ(reloaded.findNameIndex("discarded goal"),-1);
+	}
+	std::string expected=dumpGoals(reloaded);
+
+	// folding writes everything into the goals file and empties the journal
+	ASSERT_TRUE(reloaded.foldJournal());
+	std::ifstream journalFile{"journalsample.xml.journal"};
+	ASSERT_FALSE(journalFile.good());
+	GoalContainer folded;
+	folded.setJournaling(false);
+	folded.loadFile("journalsample.xml");
+	ASSERT_EQ(dumpGoals(folded),expected);
+}
+
+// a background save writes the records as they were when it was requested, edits made
+// meanwhile stay in the journal and are replayed on top of the new file
+TEST( GoalContainer, backgroundSave ) {
+	resetOptions();
+	writeTextFile("backgroundsample.xml",makeGoalText(100));
+	std::remove("backgroundsample.xml.journal");
+	std::remove("backgroundsample.xml.bin");
+	{
+		GoalContainer gc;
+		gc.loadFile("backgroundsample.xml");
+		for (int i=0;i<10;i++)	// too many edits for the journal alone
+			gc.insertGoal(Goal{"saved goal "+std::to_string(i),1,2,3.});
+		gc.saveInBackground();
+		gc.insertGoal(Goal{"goal after save",4,5,6.});
+		ASSERT_TRUE(gc.waitForSave());
+		ASSERT_TRUE(gc.isModified());// the later edit is journaled, not saved
+	}
+	GoalContainer fileOnly;
+	fileOnly.setJournaling(false);
+	fileOnly.setSnapshots(false);
+	fileOnly.loadFile("backgroundsample.xml");
+	ASSERT_EQ(fileOnly.activesize(),90);
+	ASSERT_TRUE(fileOnly.findNameIndex("saved goal 9")>=0);
+	ASSERT_EQ(fileOnly.findNameIndex("goal after save"),-1);
+
+	GoalContainer replayed;
+	replayed.loadFile("backgroundsample.xml");
+	ASSERT_EQ(replayed.activesize(),91);
+	ASSERT_TRUE(replayed.findNameIndex("goal after save")>=0);
+}
+
+// a rebased journal applies to the file being replaced as a whole and to its replacement
+// past the folded entries, so a crash on either side of the rename loses nothing
+TEST( Journal, rebase ) {
+	writeTextFile("rebasesample.xml","old");
+	writeTextFile("rebasesample2.xml","new file");
+	std::remove("rebasesample.xml.journal");
+	std::remove("rebasesample.xml.journal.stale");
+	FileSignature oldFile=FileSignature::of("rebasesample.xml");
+	FileSignature newFile=FileSignature::of("rebasesample2.xml");
+	{
+		Journal journal;
+		journal.open("rebasesample.xml.journal",oldFile);
+		journal.append(JournalEntry{JournalEntry::OP_INSERT,"folded",Goal{"folded",1,1,1.}});
+		uint64_t folded=journal.position();
+		journal.append(JournalEntry{JournalEntry::OP_INSERT,"kept",Goal{"kept",1,1,1.}});
+		journal.rebase(newFile,folded);
+		ASSERT_EQ(journal.entries(),1);
+		journal.append(JournalEntry{JournalEntry::OP_DELETE,"kept"});
+		ASSERT_EQ(journal.entries(),2);
+	}
+	Journal journal;
+	auto entries=journal.open("rebasesample.xml.journal",newFile);
+	ASSERT_EQ(entries.size(),2);
+	ASSERT_EQ(entries[0].name,"kept");
+	ASSERT_EQ(entries[1].op,JournalEntry::OP_DELETE);
+
+	ASSERT_EQ(journal.open("rebasesample.xml.journal",oldFile).size(),3);// the rename never happened
+	ASSERT_EQ(journal.open("rebasesample.xml.journal",newFile).size(),0);// now stale
+	journal.close();
+	std::ifstream stale{"rebasesample.xml.journal"};
+	ASSERT_FALSE(stale.good());	// set aside, not deleted
+	ASSERT_EQ(journal.open("rebasesample.xml.journal.stale",oldFile).size(),3);
+	journal.close();
+	std::remove("rebasesample.xml.journal.stale");
+}
+
+// compaction drops deleted records without changing what is displayed or found
+TEST( GoalContainer, compact ) {
+	resetOptions();
+	writeTextFile("compactsample.xml",makeGoalText(100));
+	GoalContainer gc;
+	gc.setJournaling(false);
+	gc.setCompactionRatio(2.);	// only on demand
+	gc.loadFile("compactsample.xml");
+	UserOptions::getInstance().setSortPrefs("pdna");
+	gc.sortGoals();
+	for (int i=0;i<30;i++)
+		gc.deleteRecord(i);
+	ASSERT_EQ(gc.size(),80);
+	std::string before=dumpGoals(gc);
+	gc.compact();
+	ASSERT_EQ(gc.size(),50);
+	ASSERT_EQ(gc.activesize(),50);
+	ASSERT_EQ(dumpGoals(gc),before);
+	Goal copy;
+	int idx=gc.getGoalByRecordID(0,copy);
+	ASSERT_EQ(gc.findNameIndex(copy.name),idx);
+
+	gc.setCompactionRatio(0.1);	// the next deletions cross the threshold
+	for (int i=0;i<6;i++)
+		gc.deleteRecord(0);
+	ASSERT_EQ(gc.size(),gc.activesize());
+	UserOptions::getInstance().setSortPrefs("");
+}
+
+// searches answered from the field indexes find exactly what a full scan finds, through edits
+TEST( GoalContainer, indexedSearch ) {
+	resetOptions();
+	writeTextFile("indexsample.xml",makeGoalText(2000));
+	GoalContainer gc;
+	gc.setJournaling(false);
+	gc.setCompactionRatio(0.01);
+	gc.loadFile("indexsample.xml");
+	UserOptions &options=UserOptions::getInstance();
+	auto check=[&]( const SearchCriteria &criteria ) {
+		options.setSearchCriteria(criteria);
+		gc.searchGoals();
+		gc.sortGoals();
+		size_t expected=0;
+		for (int i=0;i<2000;i++)
+			for (auto name:{"goal ","renamed "}) {
+				int idx=gc.findNameIndex(name+std::to_string(i));
+				if (idx>=0 && gc.matchGoal(idx,options.getSearchCriteria()))
+					expected++;
+			}
+		ASSERT_EQ(gc.searchsize(),expected);
+		ASSERT_TRUE(expected>0);
+	};
+	check(SearchCriteria{Goal{"",7,-1,-1.}});
+	check(SearchCriteria{Goal{"",-1,14,-1.}});
+	check(SearchCriteria{Goal{"",7,49,-1.}});
+	check(SearchCriteria{Goal{"",-1,-1,2.5}});
+	check(SearchCriteria{Goal{"goal 6",7,-1,2.5}});
+	check(SearchCriteria{Goal{"goal 19",-1,-1,-1.}});
+	check(SearchCriteria{Goal{"^goal 1.*9$",-1,-1,-1.}});
+	SearchCriteria ranges;
+	ranges.minPriority=90;		// a bucket range
+	check(ranges);
+	ranges.maxCompletion=49;	// two ranges, the narrower one drives the scan
+	check(ranges);
+	ranges=SearchCriteria{};
+	ranges.minCost=2.;
+	ranges.maxCost=3.5;		// a cost index range, unitcosts 2.5 and 3.5
+	check(ranges);
+	ranges.name="goal 1";
+	check(ranges);
+
+	options.setSearchCriteria(SearchCriteria{});
+	gc.searchGoals();
+	gc.sortGoals();
+	for (int i=0;i<40;i++) {
+		Goal goal;
+		gc.getGoalByRecordID(i,goal);
+		goal.priority=7;
+		goal.unitcost=2.5;
+		if (i%2)
+			goal.name="renamed "+std::to_string(i);
+		gc.modifyRecord(i,goal);
+	}
+	for (int i=0;i<40;i++)
+		gc.deleteRecord(100);	// compacts along the way
+	check(SearchCriteria{Goal{"",7,-1,-1.}});
+	check(SearchCriteria{Goal{"",7,-1,2.5}});
+	check(SearchCriteria{Goal{"goal 19",-1,-1,-1.}});
+	check(SearchCriteria{Goal{"renamed",-1,-1,-1.}});
+	check(ranges);
+
+	gc.insertGoal(Goal{"refund",7,0,-2.});	// a cost below 0, as a file may hold, is not filtered out
+	for (double maxCost:{HUGE_VAL,1.}) {
+		SearchCriteria refund;
+		refund.name="refund";
+		refund.maxCost=maxCost;
+		options.setSearchCriteria(refund);
+		gc.searchGoals();
+		ASSERT_EQ(gc.searchsize(),1) <<maxCost;
+	}
+	options.setSearchCriteria(SearchCriteria{});
+}
+
+// the full pass split over the thread pool finds the same records as the serial one
+TEST( GoalContainer, parallelSearch ) {
+	resetOptions();
+	writeTextFile("indexsample.xml",makeGoalText(5000));
+	GoalContainer gc;
+	gc.setJournaling(false);
+	gc.setTrigramIndex(false);
+	gc.loadFile("indexsample.xml");
+	for (int i=0;i<300;i+=3)
+		gc.deleteRecord(i);
+	UserOptions &options=UserOptions::getInstance();
+	SearchCriteria criteria;
+	criteria.name="goal [0-9]*7$";
+	criteria.maxCompletion=80;
+	options.setSearchCriteria(criteria);
+	auto results=[&]() {
+		options.setSearchCriteria(SearchCriteria{});	// forces a new search
+		options.setSearchCriteria(criteria);
+		gc.searchGoals();
+		gc.sortGoals();
+		return dumpGoals(gc);
+	};
+	ThreadPool::getInstance().resize(1);
+	std::string serial=results();
+	ThreadPool::getInstance().resize(4);
+	options.setParallelSearchMin(0);
+	ASSERT_EQ(results(),serial);
+	ASSERT_TRUE(gc.searchsize()>0);
+	options.setParallelSearchMin(1<<16);
+	options.setSearchCriteria(SearchCriteria{});
+	ThreadPool::getInstance().resize(0);
+}
+
+// single inserts and modifications placed into the sorted view give the order a full sort gives
+TEST( GoalContainer, incrementalView ) {
+	resetOptions();
+	writeTextFile("indexsample.xml",makeGoalText(1000));
+	GoalContainer gc;
+	gc.setJournaling(false);
+	gc.loadFile("indexsample.xml");
+	UserOptions &options=UserOptions::getInstance();
+	SearchCriteria criteria;
+	criteria.maxPriority=50;
+	options.setSearchCriteria(criteria);
+	options.setSortPrefs("pdna");
+	options.setSortCacheMB(0);	// so the view is rebuilt from scratch below
+	gc.searchGoals();
+	gc.sortGoals();
+	size_t visible=gc.searchsize();
+	int left=0;
+	for (int i=0;i<50;i++) {
+		gc.insertGoal(Goal{"inserted "+std::to_string(i),(i*31)%101,i,1.5});
+		visible+= (i*31)%101<=50;
+		Goal goal;
+		gc.getGoalByRecordID(i*3,goal);
+		goal.priority=(goal.priority+30)%101;	// some leave the results
+		left+= goal.priority>50;
+		gc.modifyRecord(i*3,goal);
+	}
+	ASSERT_TRUE(left>0);
+	ASSERT_EQ(gc.searchsize(),visible-left);
+	gc.searchGoals();
+	gc.sortGoals();		// nothing to do, the view was kept current
+	std::string incremental=dumpGoals(gc);
+	options.setSortPrefs("");
+	gc.sortGoals();
+	options.setSortPrefs("pdna");
+	gc.sortGoals();		// from scratch
+	ASSERT_EQ(incremental,dumpGoals(gc));
+	options.setSearchCriteria(SearchCriteria{});
+	options.setSortPrefs("");
+	options.setSortCacheMB(64);
+}
+
+// with paging on pages are ordered as they are shown, edits in between included
+TEST( GoalContainer, pagedView ) {
+	resetOptions();
+	writeTextFile("indexsample.xml",makeGoalText(5000));
+	GoalContainer gc;
+	GoalTester tester(&gc);
+	gc.setJournaling(false);
+	gc.loadFile("indexsample.xml");
+	UserOptions &options=UserOptions::getInstance();
+	options.setSortPrefs("cdna");
+	gc.sortGoals();
+	std::string full=dumpGoals(gc);
+
+	options.setSortCacheMB(0);
+	options.setPaging(true);
+	options.setSortPrefs("");
+	gc.sortGoals();
+	options.setSortPrefs("cdna");
+	gc.sortGoals();
+	std::string paged;
+	for (size_t first=0;first<gc.searchsize();first+=25) {
+		std::ostringstream page;
+		gc.printAll(page,first,25);
+		paged+=page.str();
+		ASSERT_LT(tester.getSortedPrefix(),gc.searchsize()) <<"first page "<<first;
+		if (first==50)
+			break;
+	}
+	ASSERT_EQ(paged,full.substr(0,paged.size()));
+
+	for (int i=0;i<20;i++) {	// in and behind the ordered prefix
+		gc.insertGoal(Goal{"paged "+std::to_string(i),50,(i*37)%101,1.});
+		Goal goal;
+		gc.getGoalByRecordID(i*7,goal);
+		goal.completion=(goal.completion+40)%101;
+		gc.modifyRecord(i*7,goal);
+	}
+	gc.deleteRecord(3);
+	std::string edited=dumpGoals(gc);
+	ASSERT_EQ(tester.getSortedPrefix(),gc.searchsize());
+	options.setPaging(false);
+	options.setSortPrefs("");
+	gc.sortGoals();
+	options.setSortPrefs("cdna");
+	gc.sortGoals();
+	ASSERT_EQ(edited,dumpGoals(gc));
+	options.setSortPrefs("");
+	options.setSortCacheMB(64);
+}
+
+// an all-numeric order with many ties, paged past the radix sort's threshold, then edited
+TEST( GoalContainer, pagedViewTies ) {
+	resetOptions();
+	writeTextFile("indexsample.xml",makeGoalText(20000));
+	GoalContainer gc;
+	gc.setJournaling(false);
+	gc.loadFile("indexsample.xml");
+	UserOptions &options=UserOptions::getInstance();
+	options.setSortCacheMB(0);
+	options.setSortPrefs("pd");
+	gc.sortGoals();
+	std::string full=dumpGoals(gc);
+
+	options.setPaging(true);
+	options.setSortPrefs("");
+	gc.sortGoals();
+	options.setSortPrefs("pd");
+	gc.sortGoals();
+	std::string paged;
+	for (int first=0;first<3000;first+=100) {
+		std::ostringstream page;
+		gc.printAll(page,first,100);
+		paged+=page.str();
+	}
+	ASSERT_EQ(paged,full.substr(0,paged.size()));
+
+	for (int i=0;i<10;i++) {
+		Goal goal;
+		gc.getGoalByRecordID(i*250,goal);
+		goal.priority=(goal.priority+50)%101;
+		gc.modifyRecord(i*250,goal);
+	}
+	std::string edited=dumpGoals(gc);
+	ASSERT_EQ(size_t(std::count(edited.begin(),edited.end(),'\n')),gc.searchsize());
+	std::istringstream rows{edited};
+	std::set<std::string> seen;
+	for (std::string row;std::getline(rows,row);)
+		ASSERT_TRUE(seen.insert(row).second) <<"shown twice: "<<row;
+	options.setPaging(false);
+	options.setSortPrefs("");
+	gc.sortGoals();
+	options.setSortPrefs("pd");
+	gc.sortGoals();
+	ASSERT_EQ(edited,dumpGoals(gc));
+	options.setSortPrefs("");
+	options.setSortCacheMB(64);
+}
+
+// switching back to a recent sort order reuses its ordering, until the records change
+TEST( GoalContainer, sortCache ) {
+	resetOptions();
+	UserOptions &options=UserOptions::getInstance();
+	options.setSearchCriteria(SearchCriteria{});	// the cache is keyed on the search too
+	options.setSortCacheMB(64);			// enough for every order below
+	writeTextFile("indexsample.xml",makeGoalText(3000));
+	GoalContainer gc, reference;
+	GoalTester tester(&gc);
+	gc.setJournaling(false);
+	reference.setJournaling(false);
+	gc.loadFile("indexsample.xml");
+	reference.loadFile("indexsample.xml");
+	auto view=[&]( GoalContainer &c, const std::string &prefs ) {
+		options.setSortPrefs(prefs);
+		c.searchGoals();
+		c.sortGoals();
+		return dumpGoals(c);
+	};
+	for (std::string prefs:{"pdna","cana","uana"})
+		view(gc,prefs);
+	ASSERT_EQ(tester.getCachedOrders(),2);
+	ASSERT_EQ(view(gc,"cana"),view(reference,"cana"));	// taken back out of the cache
+	ASSERT_EQ(tester.getCachedOrders(),2);
+
+	SearchCriteria criteria;
+	criteria.minCompletion=50;
+	options.setSearchCriteria(criteria);
+	ASSERT_EQ(view(gc,"cana"),view(reference,"cana"));	// another search, another key
+	ASSERT_EQ(tester.getCachedOrders(),3);
+	options.setSearchCriteria(SearchCriteria{});
+	ASSERT_EQ(view(gc,"pdna"),view(reference,"pdna"));
+
+	Goal goal;
+	gc.getGoalByRecordID(0,goal);
+	goal.priority=0;
+	gc.modifyRecord(0,goal);
+	reference.modifyRecord(0,goal);
+	ASSERT_EQ(tester.getCachedOrders(),0);
+	ASSERT_EQ(view(gc,"uana"),view(reference,"uana"));
+	ASSERT_EQ(view(gc,"pdna"),view(reference,"pdna"));	// the edited view was kept
+
+	options.setSortCacheMB(0);
+	view(gc,"cana");
+	ASSERT_EQ(tester.getCachedOrders(),0);
+	options.setSortCacheMB(64);
+	options.setSortPrefs("");
+}
+
+// range filters as typed at the search prompt, and back
+TEST( SearchCriteria, parseRange ) {
+	int lo=-5, hi=-5;
+	ASSERT_TRUE(SearchCriteria::parseRange(">= 80",lo,hi,0,100));
+	ASSERT_EQ(lo,80); ASSERT_EQ(hi,100);
+	ASSERT_TRUE(SearchCriteria::parseRange("<100",lo,hi,0,100));
+	ASSERT_EQ(lo,0); ASSERT_EQ(hi,99);
+	ASSERT_TRUE(SearchCriteria::parseRange("20-40",lo,hi,0,100));
+	ASSERT_EQ(lo,20); ASSERT_EQ(hi,40);
+	ASSERT_EQ(SearchCriteria::rangeText(lo,hi,0,100),"20-40");
+	ASSERT_TRUE(SearchCriteria::parseRange("-1",lo,hi,0,100));	// disabled, as before
+	ASSERT_EQ(SearchCriteria::rangeText(lo,hi,0,100),"-");
+	ASSERT_FALSE(SearchCriteria::parseRange(">x",lo,hi,0,100));
+	ASSERT_FALSE(SearchCriteria::parseRange("5-",lo,hi,0,100));
+	ASSERT_EQ(lo,0); ASSERT_EQ(hi,100);
+	double clo, chi;
+	ASSERT_TRUE(SearchCriteria::parseRange("1.5 - 2.25",clo,chi,0.,HUGE_VAL));
+	ASSERT_EQ(clo,1.5); ASSERT_EQ(chi,2.25);
+	ASSERT_TRUE(SearchCriteria::parseRange(">2.5",clo,chi,0.,HUGE_VAL));
+	ASSERT_GT(clo,2.5); ASSERT_EQ(chi,HUGE_VAL);
+	ASSERT_TRUE(SearchCriteria::parseRange("1e-5",clo,chi,0.,HUGE_VAL));	// an exponent, not a range
+	ASSERT_EQ(clo,1e-5); ASSERT_EQ(chi,1e-5);
+	ASSERT_TRUE(SearchCriteria::parseRange("2e-3-4",clo,chi,0.,HUGE_VAL));
+	ASSERT_EQ(clo,2e-3); ASSERT_EQ(chi,4.);
+	ASSERT_TRUE(SearchCriteria::parseRange("1E-6 - 2e-3",clo,chi,0.,HUGE_VAL));
+	ASSERT_EQ(clo,1e-6); ASSERT_EQ(chi,2e-3);
+}
+
+// every leading key and direction sorts by the whole spec
+TEST( SortSpec, leadingKeys ) {
+	resetOptions();
+	writeTextFile("indexsample.xml",makeGoalText(600));
+	GoalContainer gc;
+	gc.setJournaling(false);
+	gc.loadFile("indexsample.xml");
+	UserOptions &options=UserOptions::getInstance();
+	options.setSearchCriteria(SearchCriteria{});
+	gc.searchGoals();
+	for (std::string prefs:{"na","nd","pacd","pdua","cana","cdpd","uapd","udnacapa"}) {
+		options.setSortPrefs(prefs);
+		gc.sortGoals();
+		// field by field, like the recursive comparator the spec replaced
+		auto order=[&]( const Goal &a, const Goal &b ) {
+			for (size_t i=0;i<prefs.size();i+=2) {
+				int cmp=0;
+				switch (prefs[i]) {
+					case 'n': cmp=a.name.compare(b.name); break;
+					case 'p': cmp=a.priority-b.priority; break;
+					case 'c': cmp=a.completion-b.completion; break;
+					case 'u': cmp=(a.unitcost>b.unitcost)-(a.unitcost<b.unitcost); break;
+				}
+				if (cmp)
+					return prefs[i+1]=='a'? cmp : -cmp;
+			}
+			return 0;
+		};
+		Goal prev, cur;
+		gc.getGoalByRecordID(0,prev);
+		for (int id=1;id<(int)gc.searchsize();id++) {
+			gc.getGoalByRecordID(id,cur);
+			ASSERT_LE(order(prev,cur),0) <<prefs<<" at "<<id;
+			prev=cur;
+		}
+	}
+	options.setSortPrefs("");
+}
+
+// the radix path orders exactly like the comparator, ties and signed costs included
+TEST( SortSpec, radixMatchesComparator ) {
+	resetOptions();
+	GoalColumns records;
+	double costs[]={2.5,-1.25,0.,-0.,1e-300,-3e10,7.75,2.5};
+	for (int i=0;i<5000;i++)
+		records.push_back(Goal{"goal "+std::to_string(i%37),(i*7)%101,(i*13)%3*50,costs[(i*5)%8]});
+	std::vector<int> all(records.size());
+	for (size_t i=0;i<all.size();i++)
+		all[i]=i;
+	for (std::string prefs:{"pa","pd","ud","ua","pacd","cdua","uapd","pdnacaua","uanapd","na"}) {
+		SortSpec spec{prefs};
+		std::vector<int> expected=all, radix(all.rbegin(),all.rend());	// ties still end up by index
+		std::sort(expected.begin(),expected.end(),[&]( int a, int b ) {
+			return lessFrom(records,spec,0,a,b);
+		});
+		bool used=radixSort(radix.data(),radix.data()+radix.size(),records,spec);
+		ASSERT_EQ(used,prefs[0]!='n') <<prefs;
+		if (used) {
+			ASSERT_EQ(radix,expected) <<prefs;
+		}
+	}
+}
+
+// runs sorted on the pool and merged give the serial order, with odd run counts and uneven runs
+TEST( SortSpec, parallelMatchesSerial ) {
+	resetOptions();
+	GoalColumns records;
+	for (int i=0;i<7001;i++)
+		records.push_back(Goal{"goal "+std::to_string(i%53),(i*7)%101,(i*13)%3*50,double(i%11)});
+	std::vector<int> all(records.size());
+	for (size_t i=0;i<all.size();i++)
+		all[i]=i;
+	ThreadPool &pool=ThreadPool::getInstance();
+	for (unsigned threads:{2u,3u,5u})
+		for (std::string prefs:{"pa","ucd","nd","cana"}) {
+			SortSpec spec{prefs};
+			std::vector<int> expected=all, parallel=all;
+			withKeyedLess(records,spec,[&]( auto less ) {
+				auto sortRun=[&]( int *first, int *last ) {
+					if (!radixSort(first,last,records,spec))
+						std::sort(first,last,less);
+				};
+				sortRun(expected.data(),expected.data()+expected.size());
+				pool.resize(threads);
+				parallelSort(parallel,sortRun,less,pool);
+			});
+			ASSERT_EQ(parallel,expected) <<prefs<<" on "<<threads<<" threads";
+		}
+	pool.resize(0);
+}
+
 // helper for test sort below
 void testOrder( std::vector<int> *sorted, std::vector<int> *reference) {
 	ASSERT_TRUE( sorted !=nullptr );
@@ -177,6 +1210,7 @@ void testOrder( std::vector<int> *sorted, std::vector<int> *reference) {
 
 // test different ordering options using valid ordering strings in goalsample.xml
 TEST( GoalContainer, sort ) {
+	resetOptions();
 	GoalContainer gc;
 	GoalTester tester(&gc);
 	int ver=UserOptions::getInstance().getSortingVer();
@@ -192,7 +1226,7 @@ TEST( GoalContainer, sort ) {
 
 	GoalComparator comp{&gc};
 
-	for (int i=0; i< sorted->size()-1; i++) // test all consecutive pairs
+	for (size_t i=0; i+1< sorted->size(); i++) // test all consecutive pairs
 		ASSERT_TRUE( comp( (*sorted)[i], (*sorted)[i+1]));
 	
 	std::vector<int> reference{0,1,2};// as read from file
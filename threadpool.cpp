@@ -0,0 +1,96 @@
+// THREADPOOL.CPP
+// implementation of the shared worker pool
+// Copyright 2018 Thanasis Karpetis
+//
+// Distributed under the MIT software license, see the accompanying
+// file LICENSE or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+#include "threadpool.h"
+
+// joins the current workers and starts threads-1 new ones, the caller being the last one
+void ThreadPool::resize( unsigned threads ) {
+	if (threads==0)
+		threads=std::max(1u,std::thread::hardware_concurrency());
+	if (threads==size() && !stopping)
+		return;
+	stop();
+	stopping=false;
+	for (unsigned i=1;i<threads;i++)
+		workers.emplace_back(&ThreadPool::workerLoop,this);
+}
+
+void ThreadPool::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		stopping=true;
+	}
+	wake.notify_all();
+	for (auto &w:workers)
+		w.join();
+	workers.clear();
+}
+
+void ThreadPool::workerLoop() {
+	unsigned seen=0;
+	std::unique_lock<std::mutex> lock(mtx);
+	while (true) {
+		wake.wait(lock,[&]{ return stopping || (job!=nullptr && generation!=seen); });
+		if (stopping)
+			return;
+		seen=generation;
+		busy++;
+		lock.unlock();
+		drain();
+		lock.lock();
+		if (--busy==0)
+			finished.notify_all();
+	}
+}
+
+void ThreadPool::drain() {
+	size_t idx;
+	while ( (idx=nextTask.fetch_add(1)) < taskCount ) {
+		try {
+			(*job)(idx);
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(mtx);
+			if (!error)
+				error=std::current_exception();
+		}
+		if (remaining.fetch_sub(1)==1) {	// the last task of the batch
+			std::lock_guard<std::mutex> lock(mtx);
+			finished.notify_all();
+		}
+	}
+}
+
+void ThreadPool::run( size_t tasks, const std::function<void(size_t)> &fn ) {
+	if (tasks==0)
+		return;
+	if (workers.empty() || tasks==1) {	// nothing to share
+		for (size_t i=0;i<tasks;i++)
+			fn(i);
+		return;
+	}
+	std::unique_lock<std::mutex> lock(mtx);
+	job=&fn;
+	taskCount=tasks;
+	nextTask=0;
+	remaining=tasks;
+	error=nullptr;
+	generation++;
+	lock.unlock();
+	wake.notify_all();
+
+	drain();	// the caller works too
+
+	lock.lock();
+	finished.wait(lock,[&]{ return remaining==0 && busy==0; });
+	job=nullptr;
+	std::exception_ptr e=error;
+	error=nullptr;
+	lock.unlock();
+	if (e)
+		std::rethrow_exception(e);
+}